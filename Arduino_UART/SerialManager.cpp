@@ -4,15 +4,75 @@
 
 void SerialManager::flushIncomingSerial()
 {
-    while (serial->available()) serial->read();
+    while (serial->available()) { serial->read(); rxTotal++; }
     rxBufLen = 0;
     scan_pos = 0;
+    rxBundleLen = 0;
+    rxBundlePos = 0;
+}
+
+bool SerialManager::nextBundled(uint8_t& header, uint8_t* bytes, uint8_t& len)
+{
+    if (rxBundlePos + HEADER_SIZE + LEN_SIZE > rxBundleLen) {
+        rxBundleLen = rxBundlePos = 0;
+        return false;
+    }
+    uint8_t sublen = rxBundle[rxBundlePos + HEADER_SIZE];
+    if (rxBundlePos + HEADER_SIZE + LEN_SIZE + sublen > rxBundleLen) {
+        rxBundleLen = rxBundlePos = 0;
+        return false;
+    }
+    header = rxBundle[rxBundlePos];
+    len = sublen;
+    if (sublen > 0) memcpy(bytes, &rxBundle[rxBundlePos + HEADER_SIZE + LEN_SIZE], sublen);
+    rxBundlePos += HEADER_SIZE + LEN_SIZE + sublen;
+    if (header == CREDIT_HEADER) return nextBundled(header, bytes, len);  // not for the caller
+    return true;
+}
+
+void SerialManager::sendCredit()
+{
+    // received + free = rxTotal + rxLost + capacity - rxBufLen - slack: the edge
+    // only moves when a parse frees rxBuf, however full the HW buffer is.
+    int avail = serial->available();
+    int room = HW_RX_SIZE + RX_BUF_SIZE - avail - rxBufLen - CREDIT_SLACK;
+    uint16_t freeBytes = room > 0 ? (uint16_t)room : 0;
+    uint32_t received = rxTotal + rxLost + (uint32_t)avail;
+
+    uint8_t grant[CREDIT_SIZE];
+    for (int i = 0; i < 4; i++) {
+        grant[i] = (uint8_t)(received >> (8 * i));
+        grant[6 + i] = (uint8_t)(txTotal >> (8 * i));
+    }
+    grant[4] = (uint8_t)(freeBytes & 0xFF);
+    grant[5] = (uint8_t)(freeBytes >> 8);
+    writeFrame(CREDIT_HEADER, grant, CREDIT_SIZE);
+
+    advertisedEdge = received + freeBytes;
+    lastCreditMs = millis();
+}
+
+void SerialManager::takeCredit(const uint8_t* bytes, uint8_t len, uint32_t at)
+{
+    if (!creditEnabled || len < CREDIT_SIZE) return;
+    // The line keeps order: whatever the PC wrote before this frame has arrived
+    // by now or was lost (HW buffer overrun, noise). Lost bytes count as received
+    // so the PC's window doesn't shrink by them for good.
+    uint32_t sent = 0;
+    for (int i = 0; i < 4; i++) sent |= (uint32_t)bytes[6 + i] << (8 * i);
+    uint32_t arrived = at + rxLost;
+    if ((int32_t)(sent - arrived) > 0) rxLost += sent - arrived;
 }
 
 int SerialManager::sendMessage(uint8_t header, const uint8_t* bytes, uint8_t len)
 {
-    if (len > MAX_PAYLOAD) return -1;
+    if (len > MAX_PAYLOAD || header == BUNDLE_HEADER || header == CREDIT_HEADER) return -1;
+    writeFrame(header, bytes, len);
+    return 1;
+}
 
+void SerialManager::writeFrame(uint8_t header, const uint8_t* bytes, uint8_t len)
+{
     uint8_t messageSize = FRAME_OVERHEAD + len;
     uint8_t message[MAX_PAYLOAD + FRAME_OVERHEAD];
 
@@ -31,7 +91,7 @@ int SerialManager::sendMessage(uint8_t header, const uint8_t* bytes, uint8_t len
     message[messageSize - 1] = (uint8_t)((crc >> 8) & 0xFF);
 
     serial->write(message, messageSize);
-    return 1;
+    txTotal += messageSize;
 }
 
 int SerialManager::sendMessage(uint8_t header, const float* data, uint8_t numFloats)
@@ -52,7 +112,18 @@ int SerialManager::receiveMessage(uint8_t& header, uint8_t* bytes, uint8_t& len)
 
     // Drain whatever UART has into our internal buffer (bounded).
     while (serial->available() > 0 && rxBufLen < RX_BUF_SIZE)
-    { rxBuf[rxBufLen++] = (uint8_t)serial->read(); }
+    { rxBuf[rxBufLen++] = (uint8_t)serial->read(); rxTotal++; }
+
+    // Grant the space the last parse opened up (or refresh the grant).
+    if (creditEnabled) {
+        uint32_t edge = rxTotal + rxLost + (uint32_t)(HW_RX_SIZE + RX_BUF_SIZE - rxBufLen - CREDIT_SLACK);
+        if ((int32_t)(edge - advertisedEdge) >= CREDIT_STEP || millis() - lastCreditMs >= CREDIT_REFRESH_MS) {
+            sendCredit();
+        }
+    }
+
+    // Rest of a bundle received earlier, one sub-message per call.
+    if (nextBundled(header, bytes, len)) return 1;
 
     int lastStatus = -1;
 
@@ -127,10 +198,21 @@ int SerialManager::receiveMessage(uint8_t& header, uint8_t* bytes, uint8_t& len)
             continue;
         }
 
-        // Valid frame. Extract.
-        header = hdr;
-        len = plen;
-        if (plen > 0) memcpy(bytes, &rxBuf[syncIdx + SYNC_SIZE + HEADER_SIZE + LEN_SIZE], plen);
+        // Valid frame. Extract (a bundle into rxBundle, to be served from there).
+        bool bundle = (hdr == BUNDLE_HEADER);
+        bool credit = (hdr == CREDIT_HEADER);
+        if (credit) {
+            takeCredit(&rxBuf[syncIdx + SYNC_SIZE + HEADER_SIZE + LEN_SIZE], plen,
+                       rxTotal - (uint32_t)(rxBufLen - syncIdx));
+        } else if (bundle) {
+            if (plen > 0) memcpy(rxBundle, &rxBuf[syncIdx + SYNC_SIZE + HEADER_SIZE + LEN_SIZE], plen);
+            rxBundleLen = plen;
+            rxBundlePos = 0;
+        } else {
+            header = hdr;
+            len = plen;
+            if (plen > 0) memcpy(bytes, &rxBuf[syncIdx + SYNC_SIZE + HEADER_SIZE + LEN_SIZE], plen);
+        }
 
         int remaining = rxBufLen - total;
         if (remaining > 0) memmove(rxBuf, rxBuf + total, remaining);
@@ -139,6 +221,9 @@ int SerialManager::receiveMessage(uint8_t& header, uint8_t* bytes, uint8_t& len)
 
         timeoutFlag = false;
         lastTimeoutClock = millis();
+        if (credit || (bundle && !nextBundled(header, bytes, len))) {
+            continue;  // a grant, or an empty or malformed bundle: nothing to hand out
+        }
         return 1;
     }
 }
@@ -19,6 +19,22 @@
 // Total frame size: 6 + len bytes (max 6 + 48 = 54, comfortably under the
 // AVR 64-byte hardware UART RX buffer).
 //
+// Bundle frames (hdr 0xFB) carry several small messages in one payload as
+// repeated [hdr:1][len:1][bytes:len]. The PC side builds them when TX
+// bundling is on; receiveMessage() unpacks them and returns the messages one
+// per call, so callers never see header 0xFB.
+//
+// Credit frames (hdr 0xFE) carry [received:u32 LE][free:u16 LE][sent:u32 LE]:
+// bytes of the link taken in so far, room for this many more, and bytes
+// written before this frame. With setCreditFlowControl(true) receiveMessage()
+// grants the PC its free RX space (HW buffer + rxBuf) whenever a parse has
+// opened up CREDIT_STEP bytes, and every CREDIT_REFRESH_MS, so the PC sends as
+// fast as loop() actually drains instead of at a fixed baud-rate pace. The PC
+// side must enable it too (UART_Serial::setCreditFlowControl()). Grants from
+// the PC are read for their `sent` count only: the sketch doesn't wait for
+// credit, the PC's receive ring is far larger than anything sent per loop().
+// Callers never see header 0xFE.
+//
 // CALL-FREQUENCY CONTRACT: receiveMessage() is the ONLY thing draining the
 // HardwareSerial RX buffer in this design — there is no background sync
 // thread on Arduino. Caller MUST call receiveMessage() every main loop
@@ -53,10 +69,38 @@ private:
     // compaction threshold. Drops resync from O(N²) to O(N).
     int scan_pos = 0;
 
+    // Payload of the last bundle frame, and the offset of its next unread
+    // sub-message. Served before any new frame is parsed.
+    uint8_t rxBundle[48];  // MAX_PAYLOAD (declared below)
+    uint8_t rxBundleLen = 0;
+    uint8_t rxBundlePos = 0;
+
+    // Credit flow control. rxTotal counts bytes moved out of the HW buffer,
+    // rxLost bytes the PC wrote that never arrived (from its grants' `sent`),
+    // txTotal bytes written. The HW buffer size is the AVR core's where known;
+    // other cores get the AVR default, which only under-grants.
+#if defined(SERIAL_RX_BUFFER_SIZE)
+    static const int HW_RX_SIZE = SERIAL_RX_BUFFER_SIZE - 1;  // the ring keeps a slot free
+#else
+    static const int HW_RX_SIZE = 63;
+#endif
+    static const int CREDIT_SIZE = 10;
+    static const int CREDIT_STEP = 32;
+    static const int CREDIT_SLACK = 2 * (FRAME_OVERHEAD + CREDIT_SIZE);  // PC grants need no credit
+    static const unsigned long CREDIT_REFRESH_MS = 100;
+    bool creditEnabled = false;
+    uint32_t rxTotal = 0;
+    uint32_t rxLost = 0;
+    uint32_t txTotal = 0;
+    uint32_t advertisedEdge = 0;
+    unsigned long lastCreditMs = 0;
+
 public:
 
     static const uint8_t MAX_PAYLOAD = 48;          // bytes per frame payload (v3)
     static const uint8_t MAX_FLOATS  = MAX_PAYLOAD / 4;  // 12
+    static const uint8_t BUNDLE_HEADER = 0xFB;      // reserved: packed sub-messages
+    static const uint8_t CREDIT_HEADER = 0xFE;      // reserved: credit grant
 
     SerialManager(HardwareSerial& serialPort, int _timeoutPeriod_ms) : serial(&serialPort), timeoutPeriod_ms(_timeoutPeriod_ms) {}
 
@@ -65,10 +109,14 @@ public:
         byteSpacingTime_us = static_cast<long>(ceil(10000000.0 / baudRate));
         lastTimeoutClock = millis();
         serial->begin(baudRate);
+        if (creditEnabled) sendCredit();
     }
     void disconnect() { serial->end(); }
     bool isConnected() { return !timeoutFlag; }
 
+    // Credit flow control (before connect(); see above). Off by default.
+    void setCreditFlowControl(bool enabled) { creditEnabled = enabled; }
+
     // User-callable reset: drops the internal scan buffer and the kernel
     // UART input buffer, resets scan position. Use after mode switches or
     // when the application detects prolonged corruption and wants to start
@@ -76,7 +124,8 @@ public:
     void flushIncomingSerial();
 
     // Bytes-primary API (v3).
-    // sendMessage: returns 1 on success, -1 on failure (len > MAX_PAYLOAD).
+    // sendMessage: returns 1 on success, -1 on failure (len > MAX_PAYLOAD or a
+    // reserved header).
     int sendMessage(uint8_t header, const uint8_t* bytes, uint8_t len);
     // receiveMessage: caller passes a MAX_PAYLOAD-sized buffer for `bytes`.
     // Returns 1 on a valid frame, negative on no-frame / partial / bad frame.
@@ -89,6 +138,16 @@ public:
     int receiveMessage(uint8_t& header, float* data, uint8_t& numFloats);
 
 private:
+    // Pops the next sub-message of rxBundle. Returns false when the bundle is
+    // used up (or malformed, in which case the rest of it is dropped).
+    bool nextBundled(uint8_t& header, uint8_t* bytes, uint8_t& len);
+
+    // Writes a grant of the current free RX space.
+    void sendCredit();
+    // A grant from the PC, whose frame started at stream position `at`.
+    void takeCredit(const uint8_t* bytes, uint8_t len, uint32_t at);
+    void writeFrame(uint8_t header, const uint8_t* bytes, uint8_t len);
+
     // CRC-16/CCITT-FALSE — poly 0x1021, init 0xFFFF, no reflection, no xorout.
     // Test vector: crc16_ccitt("123456789", 9) == 0x29B1.
     static uint16_t crc16_ccitt(const uint8_t* data, int len) {
@@ -0,0 +1,51 @@
+#ifndef OMNISOC_BACKPRESSURE_H
+#define OMNISOC_BACKPRESSURE_H
+
+#include <cstddef>
+#include <limits>
+
+/// <summary>
+/// Limits for an outgoing queue and what to do when a producer hits them.
+/// A queue is full once either high-water mark would be exceeded, and stays
+/// "backpressured" until it has drained below both low-water marks, so
+/// producers that back off see a stable signal instead of flapping at the limit.
+///   Block:      wait for the queue to drain below low water (up to blockTimeout_ms).
+///   Fail:       reject the message; the caller decides what to do.
+///   DropOldest: discard the oldest queued messages until the new one fits.
+///   DropNewest: discard the new message (counted as dropped).
+/// Enqueue status codes shared by the OmniSoc classes:
+///   1 queued, -2 rejected or dropped at the high-water mark, -3 blocked and timed out / shut down.
+/// </summary>
+struct BackpressureOptions {
+    enum class Policy { Block, Fail, DropOldest, DropNewest };
+
+    Policy policy = Policy::DropNewest;
+    size_t highWaterBytes = 0;      // 0 = no byte limit
+    size_t lowWaterBytes = 0;       // 0 = highWaterBytes / 2
+    size_t highWaterMessages = 0;   // 0 = queue capacity
+    size_t lowWaterMessages = 0;    // 0 = highWaterMessages / 2
+    int blockTimeout_ms = -1;       // Block only; -1 = wait indefinitely
+
+    // Effective limits with the defaults above resolved against the queue capacity.
+    size_t highBytes() const { return highWaterBytes > 0 ? highWaterBytes : std::numeric_limits<size_t>::max(); }
+    size_t lowBytes() const {
+        if (highWaterBytes == 0) { return std::numeric_limits<size_t>::max(); }
+        return lowWaterBytes > 0 && lowWaterBytes < highWaterBytes ? lowWaterBytes : highWaterBytes / 2;
+    }
+    size_t highMessages(size_t capacity) const {
+        return highWaterMessages > 0 && highWaterMessages < capacity ? highWaterMessages : capacity;
+    }
+    size_t lowMessages(size_t capacity) const {
+        size_t high = highMessages(capacity);
+        return lowWaterMessages > 0 && lowWaterMessages < high ? lowWaterMessages : high / 2;
+    }
+
+    bool wouldExceed(size_t queuedBytes, size_t queuedMessages, size_t addBytes, size_t capacity) const {
+        return queuedBytes + addBytes > highBytes() || queuedMessages + 1 > highMessages(capacity);
+    }
+    bool drained(size_t queuedBytes, size_t queuedMessages, size_t capacity) const {
+        return queuedBytes <= lowBytes() && queuedMessages <= lowMessages(capacity);
+    }
+};
+
+#endif // OMNISOC_BACKPRESSURE_H
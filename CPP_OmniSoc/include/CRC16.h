@@ -0,0 +1,32 @@
+#ifndef OMNISOC_CRC16_H
+#define OMNISOC_CRC16_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+// CRC-16/CCITT-FALSE — poly 0x1021, init 0xFFFF, no reflection, no xorout.
+// crc16_ccitt("123456789", 9) == 0x29B1.
+// Shared by the UART v3 frames and the Socket_Serial binary framing. Pass a
+// previous result as `crc` to continue over a buffer split in pieces.
+// Uses the fastest engine the CPU supports (picked once, on first call).
+uint16_t crc16_ccitt(const uint8_t* data, size_t len, uint16_t crc = 0xFFFF);
+
+// Individual engines, all bit-exact with each other:
+//   Bitwise  — reference loop, 8 shifts per byte.
+//   Table    — one 256-entry table lookup per byte.
+//   Slicing8 — eight tables, 8 bytes per step.
+//   Clmul    — PCLMULQDQ folding of 16-byte blocks (x86 with PCLMUL + SSSE3);
+//              short inputs go through Slicing8.
+enum class Crc16Engine { Bitwise, Table, Slicing8, Clmul };
+
+bool crc16_engine_supported(Crc16Engine engine);
+Crc16Engine crc16_active_engine();
+const char* crc16_engine_name(Crc16Engine engine);
+// Runs `engine` directly; an unsupported engine falls back to the active one.
+uint16_t crc16_ccitt_engine(Crc16Engine engine, const uint8_t* data, size_t len, uint16_t crc = 0xFFFF);
+
+// Checks every supported engine against the check value and against the
+// bitwise reference over assorted lengths, alignments and split points.
+bool crc16_self_test();
+
+#endif // OMNISOC_CRC16_H
@@ -0,0 +1,107 @@
+#ifndef OMNISOC_FRAGMENTATION_H
+#define OMNISOC_FRAGMENTATION_H
+
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <vector>
+
+// Messages larger than one frame's payload, split into fragments.
+//
+// Fragment payload: [hdr:1][msgId:1][index:u16 LE][chunk]. The chunks in index
+// order spell [totalLen:u32 LE][message bytes]; every fragment but the last
+// carries a full chunk (payload size - 4 bytes). `hdr` is the application
+// header of the whole message; msgId tells apart messages with the same header
+// that are in flight together. At most 65536 fragments per message.
+static const size_t FRAGMENT_PREFIX = 4;   // hdr, msgId, index
+static const size_t FRAGMENT_LENGTH = 4;   // totalLen at the start of fragment 0
+static const size_t FRAGMENT_MAX_COUNT = 65536;
+
+// Fragments needed for a len-byte message with payloadSize-byte frames.
+size_t fragment_count(size_t len, size_t payloadSize);
+// Largest message that fits in FRAGMENT_MAX_COUNT fragments.
+size_t fragment_max_message(size_t payloadSize);
+// Writes fragment `index` of message[0..len) into out (payloadSize bytes of
+// room) and returns its payload length.
+size_t fragment_encode(uint8_t header, uint8_t msgId, size_t index,
+                       const uint8_t* message, size_t len, size_t payloadSize, uint8_t* out);
+
+// Receive side. Fragments are collected per (header, msgId) in a fixed pool of
+// slots, each with a buffer of at most maxMessage bytes, so memory stays
+// bounded by slots * maxMessage. A message is dropped (and counted) if it
+// doesn't finish within timeout_ms of its last fragment, if it outgrows
+// maxMessage, or if its slot is taken for a newer message while the pool is full
+// (least recently active first).
+// Headers with a stream handler are not buffered: their chunks are handed out
+// in order as they arrive, and a missing fragment aborts the message.
+// Not thread-safe: the owner serializes calls.
+class FragmentReassembler {
+public:
+    // One in-order piece of a streamed message. `bytes` is only valid during the
+    // call. `complete` marks the last piece; `aborted` (with len == 0) means the
+    // message was lost part-way and nothing more of it will follow.
+    struct Chunk {
+        uint8_t header;
+        uint8_t msgId;
+        size_t offset;
+        const uint8_t* bytes;
+        size_t len;
+        size_t total;
+        bool complete;
+        bool aborted;
+    };
+    typedef std::function<void(const Chunk& chunk)> ChunkHandler;
+    // A finished message. The handler may swap `message` out to keep it; the
+    // slot then reuses whatever buffer is left in its place.
+    typedef std::function<void(uint8_t header, std::vector<uint8_t>& message)> MessageHandler;
+
+    explicit FragmentReassembler(size_t payloadSize, size_t slots = 4, size_t maxMessage = 64 * 1024,
+                                 int timeout_ms = 1000);
+
+    // Drops anything in progress. Only while no fragment is being added.
+    void setLimits(size_t slots, size_t maxMessage, int timeout_ms);
+    void onMessage(MessageHandler handler) { messageHandler_ = std::move(handler); }
+    void onStream(uint8_t header, ChunkHandler handler) { streamHandlers_[header] = std::move(handler); }
+    bool streaming() const;   // any stream handler registered
+
+    // Feeds one fragment payload (frame payload of a fragment frame).
+    void add(const uint8_t* payload, size_t len, std::chrono::steady_clock::time_point now);
+    // Drops messages idle for longer than the timeout.
+    void expire(std::chrono::steady_clock::time_point now);
+    void reset();
+
+    size_t inProgress() const;
+    size_t dropped() const { return dropped_; }
+
+private:
+    struct Slot {
+        bool active = false;
+        bool failed = false;        // dropped: swallow the rest of its fragments
+        uint8_t header = 0;
+        uint8_t msgId = 0;
+        size_t total = SIZE_MAX;    // unknown until fragment 0
+        size_t count = 0;           // fragments expected (0 until fragment 0)
+        size_t received = 0;
+        size_t nextIndex = 0;       // streams: next fragment to hand out
+        std::vector<uint8_t> have;  // one flag per fragment index
+        std::vector<uint8_t> data;
+        std::chrono::steady_clock::time_point lastSeen;
+    };
+
+    Slot* slotFor(uint8_t header, uint8_t msgId, std::chrono::steady_clock::time_point now);
+    void addBuffered(Slot& slot, size_t index, const uint8_t* chunk, size_t len);
+    void addStreamed(Slot& slot, size_t index, const uint8_t* chunk, size_t len);
+    void drop(Slot& slot);
+    void release(Slot& slot);
+
+    size_t chunkSize_;
+    size_t maxMessage_;
+    std::chrono::milliseconds timeout_;
+    std::vector<Slot> slots_;
+    MessageHandler messageHandler_;
+    ChunkHandler streamHandlers_[256];
+    size_t dropped_ = 0;
+};
+
+#endif // OMNISOC_FRAGMENTATION_H
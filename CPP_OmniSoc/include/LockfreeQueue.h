@@ -0,0 +1,266 @@
+#ifndef OMNISOC_LOCKFREE_QUEUE_H
+#define OMNISOC_LOCKFREE_QUEUE_H
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <memory>
+#include <utility>
+#include <vector>
+
+// Bounded lock-free queues used between the OmniSoc I/O threads and
+// application threads.
+//
+// Both queues preallocate every slot up front and never destroy the element
+// objects: producers assign into a slot (so a std::string / std::vector slot
+// keeps its capacity from earlier messages) and consumers swap the slot with
+// their own object. Message storage therefore circulates between the queue and
+// the caller instead of being allocated per message once the pool is warm.
+//
+// Capacities are rounded up to a power of two.
+
+namespace omnisoc_detail {
+inline size_t roundUpPow2(size_t v) {
+    size_t p = 1;
+    while (p < v) { p <<= 1; }
+    return p;
+}
+static constexpr size_t CACHE_LINE = 64;
+}
+
+// Single-producer / single-consumer ring.
+template <typename T>
+class SPSCQueue {
+public:
+    explicit SPSCQueue(size_t capacity)
+        : slots_(omnisoc_detail::roundUpPow2(capacity < 2 ? 2 : capacity)), mask_(slots_.size() - 1) {}
+
+    SPSCQueue(const SPSCQueue&) = delete;
+    SPSCQueue& operator=(const SPSCQueue&) = delete;
+
+    // Producer: fill(T& slot) writes the element in place. Returns false if full.
+    template <typename Fill>
+    bool emplace(Fill&& fill) {
+        const size_t tail = tail_.load(std::memory_order_relaxed);
+        if (tail - headCache_ > mask_) {
+            headCache_ = head_.load(std::memory_order_acquire);
+            if (tail - headCache_ > mask_) { return false; }
+        }
+        fill(slots_[tail & mask_]);
+        tail_.store(tail + 1, std::memory_order_release);
+        return true;
+    }
+
+    bool push(const T& value) {
+        return emplace([&value](T& slot) { slot = value; });
+    }
+
+    // Consumer: swaps the front element into out. Returns false if empty.
+    bool pop(T& out) {
+        const size_t head = head_.load(std::memory_order_relaxed);
+        if (head == tailCache_) {
+            tailCache_ = tail_.load(std::memory_order_acquire);
+            if (head == tailCache_) { return false; }
+        }
+        using std::swap;
+        swap(out, slots_[head & mask_]);
+        head_.store(head + 1, std::memory_order_release);
+        return true;
+    }
+
+    // Approximate when called concurrently with the other side.
+    size_t size() const { return tail_.load(std::memory_order_acquire) - head_.load(std::memory_order_acquire); }
+    bool empty() const { return size() == 0; }
+    size_t capacity() const { return mask_ + 1; }
+
+private:
+    std::vector<T> slots_;
+    const size_t mask_;
+
+    char pad0_[omnisoc_detail::CACHE_LINE];
+    std::atomic<size_t> head_{0};  // written by the consumer
+    size_t tailCache_ = 0;         // consumer's last view of tail_
+    char pad1_[omnisoc_detail::CACHE_LINE];
+    std::atomic<size_t> tail_{0};  // written by the producer
+    size_t headCache_ = 0;         // producer's last view of head_
+    char pad2_[omnisoc_detail::CACHE_LINE];
+};
+
+// Multi-producer bounded queue (Dmitry Vyukov's sequence-numbered ring).
+// Producers never block each other beyond a CAS on the enqueue index; a
+// consumer only touches the dequeue index. The algorithm is also safe with
+// several consumers.
+template <typename T>
+class MPSCQueue {
+public:
+    explicit MPSCQueue(size_t capacity)
+        : mask_(omnisoc_detail::roundUpPow2(capacity < 2 ? 2 : capacity) - 1), cells_(new Cell[mask_ + 1]) {
+        for (size_t i = 0; i <= mask_; ++i) {
+            cells_[i].sequence.store(i, std::memory_order_relaxed);
+        }
+    }
+
+    MPSCQueue(const MPSCQueue&) = delete;
+    MPSCQueue& operator=(const MPSCQueue&) = delete;
+
+    // Producer: fill(T& slot) writes the element in place. Returns false if full.
+    template <typename Fill>
+    bool emplace(Fill&& fill) {
+        Cell* cell;
+        size_t pos = enqueuePos_.load(std::memory_order_relaxed);
+        for (;;) {
+            cell = &cells_[pos & mask_];
+            size_t seq = cell->sequence.load(std::memory_order_acquire);
+            intptr_t diff = (intptr_t)seq - (intptr_t)pos;
+            if (diff == 0) {
+                if (enqueuePos_.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) { break; }
+            }
+            else if (diff < 0) {
+                return false;
+            }
+            else {
+                pos = enqueuePos_.load(std::memory_order_relaxed);
+            }
+        }
+        fill(cell->data);
+        cell->sequence.store(pos + 1, std::memory_order_release);
+        return true;
+    }
+
+    bool push(const T& value) {
+        return emplace([&value](T& slot) { slot = value; });
+    }
+
+    // Consumer: swaps the front element into out. Returns false if empty.
+    bool pop(T& out) {
+        Cell* cell;
+        size_t pos = dequeuePos_.load(std::memory_order_relaxed);
+        for (;;) {
+            cell = &cells_[pos & mask_];
+            size_t seq = cell->sequence.load(std::memory_order_acquire);
+            intptr_t diff = (intptr_t)seq - (intptr_t)(pos + 1);
+            if (diff == 0) {
+                if (dequeuePos_.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) { break; }
+            }
+            else if (diff < 0) {
+                return false;
+            }
+            else {
+                pos = dequeuePos_.load(std::memory_order_relaxed);
+            }
+        }
+        using std::swap;
+        swap(out, cell->data);
+        cell->sequence.store(pos + mask_ + 1, std::memory_order_release);
+        return true;
+    }
+
+    // Approximate when called concurrently with producers/consumers.
+    size_t size() const {
+        size_t enq = enqueuePos_.load(std::memory_order_acquire);
+        size_t deq = dequeuePos_.load(std::memory_order_acquire);
+        return enq > deq ? enq - deq : 0;
+    }
+    bool empty() const { return size() == 0; }
+    size_t capacity() const { return mask_ + 1; }
+
+private:
+    struct Cell {
+        std::atomic<size_t> sequence;
+        T data;
+    };
+
+    const size_t mask_;
+    std::unique_ptr<Cell[]> cells_;
+
+    char pad0_[omnisoc_detail::CACHE_LINE];
+    std::atomic<size_t> enqueuePos_{0};
+    char pad1_[omnisoc_detail::CACHE_LINE];
+    std::atomic<size_t> dequeuePos_{0};
+    char pad2_[omnisoc_detail::CACHE_LINE];
+};
+
+// Single-producer / single-consumer byte ring for stream receive paths.
+// The producer reads straight into writable spans; the consumer parses in place
+// through offset-based, wraparound-aware views and releases bytes with consume(),
+// so nothing is erased or moved when a frame is taken out.
+class ByteRing {
+public:
+    explicit ByteRing(size_t capacity)
+        : mask_(omnisoc_detail::roundUpPow2(capacity < 2 ? 2 : capacity) - 1), data_(new uint8_t[mask_ + 1]) {}
+
+    ByteRing(const ByteRing&) = delete;
+    ByteRing& operator=(const ByteRing&) = delete;
+
+    // ---- Producer ----
+    // First contiguous free span (may be shorter than freeSpace() at the wrap point).
+    uint8_t* writePtr(size_t& contiguous) {
+        const size_t tail = tail_.load(std::memory_order_relaxed);
+        const size_t free = capacity() - (tail - head_.load(std::memory_order_acquire));
+        const size_t pos = tail & mask_;
+        contiguous = free < capacity() - pos ? free : capacity() - pos;
+        return data_.get() + pos;
+    }
+
+    void commit(size_t n) { tail_.store(tail_.load(std::memory_order_relaxed) + n, std::memory_order_release); }
+
+    // Copies as much as fits; returns the number of bytes taken.
+    size_t write(const uint8_t* src, size_t n) {
+        size_t done = 0;
+        while (done < n) {
+            size_t span = 0;
+            uint8_t* dst = writePtr(span);
+            if (span == 0) { break; }
+            if (span > n - done) { span = n - done; }
+            std::memcpy(dst, src + done, span);
+            commit(span);
+            done += span;
+        }
+        return done;
+    }
+
+    // ---- Consumer ----
+    size_t size() const { return tail_.load(std::memory_order_acquire) - head_.load(std::memory_order_relaxed); }
+
+    uint8_t at(size_t offset) const { return data_[(head_.load(std::memory_order_relaxed) + offset) & mask_]; }
+
+    // Splits [offset, offset + len) into at most two contiguous pieces; returns the piece count.
+    int segments(size_t offset, size_t len, const uint8_t*& p1, size_t& n1, const uint8_t*& p2, size_t& n2) const {
+        const size_t pos = (head_.load(std::memory_order_relaxed) + offset) & mask_;
+        p1 = data_.get() + pos;
+        n1 = len < capacity() - pos ? len : capacity() - pos;
+        p2 = data_.get();
+        n2 = len - n1;
+        return n2 > 0 ? 2 : 1;
+    }
+
+    void copyOut(size_t offset, uint8_t* dst, size_t len) const {
+        const uint8_t* p1;
+        const uint8_t* p2;
+        size_t n1, n2;
+        segments(offset, len, p1, n1, p2, n2);
+        if (n1 > 0) { std::memcpy(dst, p1, n1); }
+        if (n2 > 0) { std::memcpy(dst + n1, p2, n2); }
+    }
+
+    void consume(size_t n) { head_.store(head_.load(std::memory_order_relaxed) + n, std::memory_order_release); }
+
+    // Total bytes ever committed; lets the consumer tell whether anything arrived since it last looked.
+    size_t written() const { return tail_.load(std::memory_order_acquire); }
+    // Total bytes ever consumed (consumer side): the stream position of offset 0.
+    size_t consumed() const { return head_.load(std::memory_order_relaxed); }
+    size_t capacity() const { return mask_ + 1; }
+
+private:
+    const size_t mask_;
+    std::unique_ptr<uint8_t[]> data_;
+
+    char pad0_[omnisoc_detail::CACHE_LINE];
+    std::atomic<size_t> head_{0};  // written by the consumer
+    char pad1_[omnisoc_detail::CACHE_LINE];
+    std::atomic<size_t> tail_{0};  // written by the producer
+    char pad2_[omnisoc_detail::CACHE_LINE];
+};
+
+#endif // OMNISOC_LOCKFREE_QUEUE_H
@@ -0,0 +1,213 @@
+#ifndef OMNISOC_RELIABLE_CHANNEL_H
+#define OMNISOC_RELIABLE_CHANNEL_H
+
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+class UART_Serial;
+class Socket_Serial;
+
+// ReliableChannel::Options.
+struct ReliableChannelOptions {
+    size_t window = 0;              // frames in flight; 0 = from the bandwidth-delay product
+    size_t linkBytesPerSecond = 0;  // for window == 0; 0 = unknown (window of 64)
+    int initialRto_ms = 200;
+    int minRto_ms = 50;
+    int maxRto_ms = 2000;
+    int ackDelay_ms = 2;            // 0 = ack every data frame at once
+    int sendTimeout_ms = -1;        // window full: -1 = wait, 0 = fail with -2
+};
+
+// Opt-in reliable delivery on top of a frame link (UART_Serial, or Socket_Serial in
+// a binary framing). Headers marked with setReliable() are carried inside HEADER
+// frames with a sequence number, delivered to the peer's channel exactly once and
+// in order, and retransmitted until acknowledged. Other headers go straight to the
+// link with no added bytes, locking or waiting.
+//
+// Channel frame payload:
+//   [flags:1][epoch:1][seq:u16 LE][ack:u16 LE][sack:u16 LE][hdr:1][bytes]
+// flags: bit 0 = carries data, bit 1 = ack/sack are valid, bit 2 = seq is the
+// sender's oldest unacked frame. epoch and the first sequence number are random
+// per channel. A receiver adopts the sender's numbering at a bit-2 frame from a
+// new epoch, or from its own epoch when seq is ahead of the next expected frame
+// or more than MAX_WINDOW behind it (everything before a bit-2 frame has been
+// acked, so neither can happen without a restart). A restarted peer is picked up
+// without a handshake.
+// ack is the next sequence number expected from the peer; sack bit i means
+// ack + 1 + i arrived out of order. An ack-only frame stops after sack (8 bytes).
+// Acks ride on outgoing data frames; with nothing to carry them, an ack-only frame
+// goes out after ackDelay_ms, or at once when a gap or duplicate shows up.
+//
+// The sender keeps up to `window` frames in flight. A frame is retransmitted when
+// its RTO expires (Jacobson/Karels estimate, doubled per expiry) or as soon as
+// three later frames are selectively acked. With window == 0 the window follows
+// the link's bandwidth-delay product: linkBytesPerSecond * minimum RTT, in
+// full-size frames. Both ends need a channel; only the sending side marks headers
+// reliable, the receiving channel delivers whatever arrives in HEADER frames.
+class ReliableChannel {
+public:
+    typedef std::function<int(uint8_t header, const uint8_t* bytes, size_t len)> SendFunction;
+    typedef std::function<void(uint8_t header, const uint8_t* bytes, size_t len)> MessageCallback;
+
+    typedef ReliableChannelOptions Options;
+
+    struct Stats {
+        uint64_t sent = 0;              // reliable frames, first transmission
+        uint64_t retransmitted = 0;     // all retransmissions
+        uint64_t fastRetransmits = 0;   // of those, triggered by selective acks
+        uint64_t timeouts = 0;          // RTO expiries
+        uint64_t delivered = 0;         // reliable messages handed to the application
+        uint64_t duplicates = 0;        // received again after delivery (lost acks)
+        uint64_t outOfOrder = 0;        // arrived past a gap (a loss on the way in)
+        uint64_t acksSent = 0;          // ack-only frames
+        uint64_t droppedIncoming = 0;   // delivered with no callback and a full queue
+        size_t inFlight = 0;
+        size_t window = 0;
+        double srtt_ms = -1;
+        double rto_ms = 0;
+    };
+
+    static constexpr uint8_t HEADER = 0xFD;
+    static constexpr size_t OVERHEAD = 9;            // channel bytes in front of a data payload
+    static constexpr size_t MAX_WINDOW = 256;
+    static constexpr size_t RX_QUEUE_DEPTH = 256;
+
+    // Generic link: `send` writes one frame, maxPayload is the link's frame payload
+    // limit. Feed the link's incoming HEADER frames to handleFrame().
+    ReliableChannel(SendFunction send, size_t maxPayload, const Options& options = Options());
+    // Over a UART: sends with sendMessage(), registers an onHeader(HEADER) handler
+    // (so construct before connect()) and takes linkBytesPerSecond from the baud rate.
+    // The handler stays registered; once the channel is destroyed it drops frames,
+    // so the UART may go on reading (and outlive the channel).
+    explicit ReliableChannel(UART_Serial& uart, const Options& options = Options());
+    // Over a binary-framed Socket_Serial: sends with sendMessage(). The socket has a
+    // single binary callback, so pass incoming frames to handleFrame() from it or
+    // from the receiveMessage() loop. Payloads are capped at 4 KB per message.
+    explicit ReliableChannel(Socket_Serial& socket, const Options& options = Options());
+    ~ReliableChannel();
+
+    ReliableChannel(const ReliableChannel&) = delete;
+    ReliableChannel& operator=(const ReliableChannel&) = delete;
+
+    // Which headers go through the channel (set before sending).
+    void setReliable(uint8_t header, bool reliable = true) { reliable_[header] = reliable; }
+    bool isReliable(uint8_t header) const { return reliable_[header]; }
+
+    // Reliable headers: returns 1 once the frame is sent and held for retransmission,
+    // -1 if len > maxMessage(), -2 if the window is full and sendTimeout_ms is 0,
+    // -3 if the wait timed out or the channel is closing. Other headers: the link's
+    // own send status.
+    int sendMessage(uint8_t header, const uint8_t* bytes, size_t len);
+    size_t maxMessage() const { return maxData_; }
+
+    // Returns false (and does nothing) unless header == HEADER.
+    bool handleFrame(uint8_t header, const uint8_t* bytes, size_t len);
+
+    // In-order delivery of reliable messages. With a callback (set before traffic) it
+    // runs on the thread that called handleFrame(), `bytes` valid during the call;
+    // otherwise messages wait for receiveMessage() (up to RX_QUEUE_DEPTH).
+    void onMessage(MessageCallback callback) { messageCallback_ = std::move(callback); }
+    // Returns 1 and swaps the message into `bytes`, or -1 if none is waiting.
+    int receiveMessage(uint8_t& header, std::vector<uint8_t>& bytes);
+
+    // Blocks until every reliable frame sent so far is acknowledged, up to timeout_ms
+    // (-1 = no timeout). Returns true if nothing is left in flight.
+    bool flush(int timeout_ms);
+    Stats getStats();
+
+private:
+    struct Pending {
+        bool acked = true;
+        bool retransmitted = false;
+        uint16_t seq = 0;
+        uint8_t header = 0;
+        size_t len = 0;
+        std::vector<uint8_t> bytes;
+        std::chrono::steady_clock::time_point sentAt;
+    };
+    struct Received {
+        bool have = false;
+        uint16_t seq = 0;
+        uint8_t header = 0;
+        size_t len = 0;
+        std::vector<uint8_t> bytes;
+    };
+    struct Delivery {
+        uint8_t header;
+        std::vector<uint8_t> bytes;
+    };
+
+    void start();
+    void transmit(Pending& frame, std::chrono::steady_clock::time_point now);   // mutex_ held
+    void sendAck(std::chrono::steady_clock::time_point now);                    // mutex_ held
+    void writeAck(uint8_t* out);                                               // mutex_ held
+    void processAck(uint16_t ack, uint16_t sack, std::chrono::steady_clock::time_point now);  // mutex_ held
+    size_t processData(uint16_t seq, uint8_t header, const uint8_t* bytes, size_t len,
+                       std::chrono::steady_clock::time_point now);             // mutex_ held
+    void sampleRtt(std::chrono::steady_clock::duration rtt);                   // mutex_ held
+    void resetRto();                                                            // mutex_ held
+    void updateWindow();                                                        // mutex_ held
+    size_t inFlight() const { return (uint16_t)(sndNext_ - sndUna_); }
+    void deliver(const Received& frame);
+    void timerThread();
+
+    // What a link's receive handler calls through: the destructor clears `channel`
+    // under `mutex`, which also waits out a handleFrame() already running.
+    struct LinkHook {
+        std::mutex mutex;
+        ReliableChannel* channel = nullptr;
+    };
+    std::shared_ptr<LinkHook> hook_;
+
+    SendFunction send_;
+    size_t maxData_;
+    size_t wireFrame_;
+    Options options_;
+    bool reliable_[256] = {};
+
+    // Sender and receiver state, timers and stats: all under mutex_. handleFrame()
+    // callers are serialized by receive_mutex_, which also covers the delivered
+    // slots' contents while callbacks read them outside mutex_.
+    std::mutex mutex_;
+    std::mutex receive_mutex_;
+    std::condition_variable timer_cv_;   // timer thread: new deadline or stop
+    std::condition_variable space_cv_;   // senders and flush(): acks came in
+    std::thread timer_thread_;
+    bool running_ = true;
+
+    uint8_t epoch_;
+    uint16_t sndNext_ = 0;
+    uint16_t sndUna_ = 0;
+    size_t window_;
+    std::vector<Pending> pending_;
+    std::vector<uint8_t> txFrame_;
+
+    int peerEpoch_ = -1;                 // -1 until the first data frame
+    uint16_t rcvNext_ = 0;
+    std::vector<Received> received_;
+    bool ackPending_ = false;
+    std::chrono::steady_clock::time_point ackDeadline_;
+
+    std::chrono::steady_clock::duration srtt_{0};
+    std::chrono::steady_clock::duration rttvar_{0};
+    std::chrono::steady_clock::duration rttMin_{0};
+    std::chrono::steady_clock::duration rto_;
+    bool haveRtt_ = false;
+    Stats stats_;
+
+    MessageCallback messageCallback_;
+    std::mutex queue_mutex_;
+    std::deque<Delivery> queue_;
+    std::vector<std::vector<uint8_t>> spare_;
+    uint64_t droppedIncoming_ = 0;       // under queue_mutex_
+};
+
+#endif // OMNISOC_RELIABLE_CHANNEL_H
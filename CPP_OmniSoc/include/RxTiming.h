@@ -0,0 +1,31 @@
+#ifndef OMNISOC_RX_TIMING_H
+#define OMNISOC_RX_TIMING_H
+
+#include <chrono>
+
+/// <summary>
+/// When a received message went through each receive stage, all on steady_clock
+/// so the stamps can be compared with each other and with the application's own
+/// clock. A stage that wasn't recorded is left at the clock's epoch (isSet()).
+///   arrival:    the read that returned the message's first byte came back from
+///               the fd. For transport-delay compensation this is the one to use.
+///               Unset if UART_Serial lost track of that read (see rxMarks_).
+///   kernel:     Socket_Serial with kernelTimestamps: when the kernel received the
+///               data of that read (SO_TIMESTAMPNS), moved onto steady_clock by the
+///               time it then waited in the socket. Unset otherwise.
+///   parsed:     the message was cut out of the receive buffer (CRC checked).
+///   dispatched: it was handed to the application: popped by a receive call, or
+///               passed to a callback.
+/// </summary>
+struct RxTiming {
+    typedef std::chrono::steady_clock::time_point TimePoint;
+
+    TimePoint arrival;
+    TimePoint kernel;
+    TimePoint parsed;
+    TimePoint dispatched;
+
+    static bool isSet(TimePoint t) { return t.time_since_epoch().count() != 0; }
+};
+
+#endif // OMNISOC_RX_TIMING_H
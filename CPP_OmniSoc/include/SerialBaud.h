@@ -0,0 +1,11 @@
+#ifndef OMNISOC_SERIALBAUD_H
+#define OMNISOC_SERIALBAUD_H
+
+// Sets an arbitrary baud rate (e.g. 250000, 3500000) on an open serial port fd,
+// for rates the C library has no Bxxx constant for. Linux only: termios2 with
+// BOTHER (TCGETS2/TCSETS2); elsewhere returns false. Only the speed bits change.
+// The driver may round to what its clock divisor allows: actualBaud (if not null)
+// gets the rate it reports back. Returns false if the driver refused the rate.
+bool serial_set_custom_baud(int fd, unsigned int baud, unsigned int* actualBaud);
+
+#endif // OMNISOC_SERIALBAUD_H
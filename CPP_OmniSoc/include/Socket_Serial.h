@@ -2,36 +2,225 @@
 #define SOCKET_SERIAL_H
 
 #include <boost/asio.hpp>
+#include <chrono>
+#include <functional>
+#include <memory>
+#include <random>
 #include <string>
 #include <vector>
 #include <thread>
 #include <mutex>
+#include <atomic>
 #include <condition_variable>
 
+#include "Backpressure.h"
+#include "LockfreeQueue.h"
+#include "RxTiming.h"
+#include "StreamParser.h"
+
 class Socket_Serial {
+public:
+    /// <summary>
+    /// Send-side coalescing controls, per connection.
+    /// tcpNoDelay: disable Nagle (applied on connect, and immediately if already connected).
+    /// corkWindow_us: hold queued messages up to this long so more can join the same write (0 = flush immediately).
+    /// maxBatchBytes: upper bound on payload bytes gathered into one write; a cork window also ends early once reached.
+    /// </summary>
+    struct CoalescingOptions {
+        bool tcpNoDelay = true;
+        int corkWindow_us = 0;
+        size_t maxBatchBytes = 256 * 1024;
+    };
+
+    /// <summary>
+    /// Wire framing (set before connect; both ends must match).
+    /// Delimited: std::string messages separated by msgDelimiter (default, original protocol).
+    /// LengthPrefixed: binary [hdr:1][len:4 LE][bytes] frames.
+    /// LengthPrefixedCRC: UART v3 layout with a 32-bit length,
+    ///   [0xA5][0x5A][hdr:1][len:4 LE][bytes][crc16_lo][crc16_hi], CRC-16/CCITT-FALSE over [hdr][len][bytes].
+    /// Binary modes use sendMessage()/receiveMessage() instead of send()/receive().
+    /// </summary>
+    enum class Framing { Delimited, LengthPrefixed, LengthPrefixedCRC };
+
+    /// <summary>
+    /// Liveness controls, per connection. Keepalives only go out when nothing else
+    /// was written for keepaliveInterval_ms, and the link is dropped after timeout_ms
+    /// without a single received byte. Both are wall-clock times, independent of period_ms.
+    /// keepaliveInterval_ms: 0 = period_ms (the original one-heartbeat-per-tick contract).
+    /// timeout_ms: 0 = missedHeartbeatLimit * period_ms (the original tick-count timeout).
+    /// measureRtt: keepalives become pings the peer echoes, giving RTT samples.
+    ///   Needs a peer on this version (older peers would see the pings as messages).
+    /// </summary>
+    struct LivenessOptions {
+        int keepaliveInterval_ms = 0;
+        int timeout_ms = 0;
+        bool measureRtt = false;
+    };
+
+    /// <summary>
+    /// Snapshot of the link state. Times are in ms; RTT fields are -1 until the first echo.
+    /// </summary>
+    struct LivenessStatus {
+        bool connected = false;
+        double sinceLastReceive_ms = -1;
+        double sinceLastSend_ms = -1;
+        double rttLast_ms = -1;
+        double rttSmoothed_ms = -1;   // EWMA, gain 1/8
+        double rttMin_ms = -1;
+        uint64_t rttSamples = 0;
+        uint64_t keepalivesSent = 0;
+    };
+
+    /// <summary>
+    /// Reconnect behaviour of the connection thread. After a dropped link the first
+    /// attempt is immediate; each failed attempt then waits initialBackoff_ms, growing
+    /// by multiplier up to maxBackoff_ms, randomized by +/- jitter (fraction of the delay).
+    /// connectTimeout_ms bounds one client connect attempt (<= 0 = OS timeout).
+    /// </summary>
+    struct ReconnectOptions {
+        int initialBackoff_ms = 10;
+        int maxBackoff_ms = 1000;
+        double multiplier = 2.0;
+        double jitter = 0.2;
+        int connectTimeout_ms = 2000;
+    };
+
+    typedef std::function<void(boost::string_view msg)> MessageCallback;
+    typedef std::function<void(uint8_t header, const uint8_t* bytes, size_t len)> BinaryMessageCallback;
+
+    struct BinaryMessage {
+        uint8_t header = 0;
+        std::vector<uint8_t> bytes;
+        RxTiming timing;
+    };
+
+    // Header reserved for link control in the binary framings (keepalives).
+    // Frames with it are consumed internally and cannot be sent by the application.
+    static constexpr uint8_t LINK_CONTROL_HEADER = 0xFF;
+    // Payload limit of the uint8_t-length receiveMessage overloads (= UART_Serial::MAX_PAYLOAD),
+    // so code written against UART_Serial keeps its buffer sizes.
+    static constexpr uint8_t COMPAT_MAX_PAYLOAD = 48;
+
+    // Link-control messages. Delimited framing: "\x05<seq>" is a ping, "\x06<seq>" its
+    // echo (seq in decimal). Binary framings: a LINK_CONTROL_HEADER frame carrying
+    // [type:1][seq:4 LE]; the empty control frame is a plain keepalive.
+    static constexpr char PING_PREFIX = 0x05;
+    static constexpr char PONG_PREFIX = 0x06;
+    static constexpr uint8_t CONTROL_PING = 1;
+    static constexpr uint8_t CONTROL_PONG = 2;
+    /// Returns CONTROL_PING / CONTROL_PONG for a delimited link-control message, 0 otherwise.
+    static int parseLinkControl(boost::string_view msg, uint32_t& seq);
+
 private:
+    // A delimited message in the incoming queue, with its receive timeline.
+    struct IncomingMessage {
+        std::string text;
+        RxTiming timing;
+    };
+
     boost::asio::io_context io_context_;
     boost::asio::ip::tcp::socket socket_;
     std::shared_ptr<boost::asio::ip::tcp::acceptor> acceptor_;
+    std::vector<boost::asio::ip::tcp::endpoint> endpoints_;      // resolved once, dropped after a failed attempt
     std::thread connection_thread_;
+
+    // Connection state changes (connected, dropped, shutdown) are signalled on
+    // state_cv_, so connect(blocking) and the reconnect loop never poll.
+    std::mutex state_mutex_;
+    std::condition_variable state_cv_;
+    ReconnectOptions reconnect_;                                 // guarded by state_mutex_
+    std::mt19937 backoffRng_{std::random_device{}()};
     std::thread serial_thread_;
+    // Application <-> I/O thread queues. send()/sendMessage() push from any thread
+    // without locking and the writer is the only consumer. The I/O thread is the
+    // only producer of the incoming queues; in_buffer_mutex_ and out_buffer_mutex_
+    // only serialize the consumer side (receive() callers, writer vs clearOutBuffer),
+    // so producers never wait on them or on socket I/O.
     std::mutex in_buffer_mutex_;
     std::mutex out_buffer_mutex_;
-    std::vector<std::string> incoming_buffer_;
-    std::vector<std::string> outgoing_buffer_;
+    std::unique_ptr<SPSCQueue<IncomingMessage>> incoming_buffer_;
+    std::unique_ptr<SPSCQueue<BinaryMessage>> incoming_frames_;  // binary framings
+    std::unique_ptr<MPSCQueue<std::string>> outgoing_buffer_;    // delimited messages or encoded frames
+    std::atomic<size_t> outgoingBytes_{0};
+    std::atomic<int64_t> firstQueuedTime_{0};                    // steady_clock ticks when the queue last went non-empty
+    std::atomic<size_t> droppedOutgoing_{0};
+    std::atomic<size_t> droppedIncoming_{0};
+    CoalescingOptions coalescing_;                               // guarded by out_buffer_mutex_
+
+    // Backpressure. Producers only take backpressure_mutex_ once a high-water mark
+    // is hit; the fast path compares against the cached limits.
+    std::mutex backpressure_mutex_;
+    std::condition_variable tx_space_cv_;
+    BackpressureOptions backpressure_;                           // guarded by backpressure_mutex_
+    std::atomic<size_t> highWaterBytes_{SIZE_MAX};
+    std::atomic<size_t> highWaterMessages_{SIZE_MAX};
+    std::atomic<bool> backpressured_{false};
+    std::atomic<int> txWaiters_{0};
+
+    // Receive notification. rxWaiters_ lets the I/O thread skip the mutex/notify
+    // entirely while nobody is blocked in waitForMessages().
+    std::mutex rx_wait_mutex_;
+    std::condition_variable rx_wait_cv_;
+    std::atomic<int> rxWaiters_{0};
+    MessageCallback messageCallback_;
+    BinaryMessageCallback binaryMessageCallback_;
+
+    // Messages taken off outgoing_buffer_ for writing, and the gather list
+    // for the batch in flight. Owned by whichever thread does the writing.
+    // Slots are swapped with the queue's, so their storage is reused.
+    // writeIndex_ only passes a batch once it is written; writeBatchCount_ is
+    // the size of the batch in flight.
+    std::vector<std::string> writing_buffer_;
+    size_t writingCount_ = 0;
+    size_t writeIndex_ = 0;
+    size_t writeBatchCount_ = 0;
+    size_t batchLimit_ = 0;
+    std::vector<boost::asio::const_buffer> write_sequence_;
+
+    // Event-driven I/O state. Only touched from the io thread (the thread
+    // running io_context_) except flushPosted_, which send() uses to avoid
+    // posting a flush per message.
+    boost::asio::steady_timer heartbeat_timer_;
+    boost::asio::steady_timer cork_timer_;
+    bool writeInProgress_ = false;
+    bool corkArmed_ = false;
+    std::atomic<bool> flushPosted_{false};
+
+    // Liveness. Times are steady_clock ticks; written by the I/O thread, readable anywhere.
+    std::mutex liveness_mutex_;
+    LivenessOptions liveness_;                                   // guarded by liveness_mutex_
+    std::atomic<int64_t> lastReceiveTime_{0};
+    std::atomic<int64_t> lastSendTime_{0};
+    std::atomic<int64_t> rttLast_ns_{-1};
+    std::atomic<int64_t> rttSmoothed_ns_{-1};
+    std::atomic<int64_t> rttMin_ns_{-1};
+    std::atomic<uint64_t> rttSamples_{0};
+    std::atomic<uint64_t> keepalivesSent_{0};
+    uint32_t pingSeq_ = 0;
+    int64_t pingSentTime_ = 0;                                   // 0 = no ping outstanding
+    std::string keepaliveBytes_;                                 // the keepalive being written
+
+    // Receive timing, I/O thread only. readTiming_ has the arrival (and kernel)
+    // stamps of the last read, pendingTiming_ those of the read that holds the first
+    // unparsed byte. rxTiming_ is the message being parsed or handed to a callback.
+    RxTiming readTiming_;
+    RxTiming pendingTiming_;
+    RxTiming rxTiming_;
 
     bool asyncronousFlag = false;
     bool autoReconnect = false;
-    int missedHeartbeats = 0;
     bool isServer = false;
-    bool connectedFlag = false;
-    bool killFlag = false;
+    std::atomic<bool> connectedFlag{false};
+    std::atomic<bool> killFlag{false};
     std::string msgDelimiter = ";";
-    std::string inMessageRemainder = "";
+    // Receive side: bytes are read straight into the parser's buffer and split in place.
+    DelimiterParser parser_{msgDelimiter};
+    FrameParser frameParser_;
+    std::string heartbeatBytes_ = msgDelimiter;  // bare delimiter, or an empty link-control frame
 
     std::string IP_Address;
     std::string port;
-    int period_ms;
+    int period_ms = 10;
 
 public:
     Socket_Serial(const std::string& _IP_Address, const std::string& _port, bool _isServer, bool _asyncronousFlag = true);
@@ -39,8 +228,74 @@ public:
 
     void connect(bool blocking_flag, bool auto_reconnect, int _period_ms);
     void disconnect();
-    void send(const std::string& msg);
+    /// Returns 1 when queued, -1 if framing is not Delimited, -2 if rejected or dropped at the
+    /// high-water mark, -3 if a Block-policy send timed out or the socket was shut down.
+    int send(const std::string& msg);
     std::vector<std::string> receive(int count = -1);
+    /// Pooled variant: fills `out` by swapping strings with the queue's slots, so a
+    /// caller that reuses the same vector recycles message storage. Returns the count.
+    size_t receive(std::vector<std::string>& out, int count = -1);
+    /// As above, plus each message's receive timeline in timing[i] (RxTiming.h).
+    size_t receive(std::vector<std::string>& out, std::vector<RxTiming>& timing, int count = -1);
+
+    // Binary framing API, same shape as UART_Serial's so application code can run over either.
+    // sendMessage: returns 1 when queued, -1 on failure (Delimited framing, reserved header,
+    // or len > maxFramePayload), -2/-3 from backpressure as for send().
+    int sendMessage(uint8_t header, const uint8_t* bytes, uint32_t len);
+    int sendMessage(uint8_t header, const float* data, uint32_t numFloats);
+    // receiveMessage: returns 1 on a frame, -1 if none is queued, -5 if the frame is larger
+    // than the caller's buffer (the frame is dropped).
+    int receiveMessage(uint8_t& header, uint8_t* bytes, uint32_t& len, uint32_t maxLen);
+    int receiveMessage(uint8_t& header, std::vector<uint8_t>& bytes);
+    // Pops the whole frame, receive timeline included (message.bytes is swapped out).
+    int receiveMessage(BinaryMessage& message);
+    // UART_Serial-compatible overloads: caller passes a COMPAT_MAX_PAYLOAD-sized buffer.
+    // The float version returns -6 if the payload length is not a multiple of 4 bytes.
+    int receiveMessage(uint8_t& header, uint8_t* bytes, uint8_t& len);
+    int receiveMessage(uint8_t& header, float* data, uint8_t& numFloats);
+
+    void setCoalescing(const CoalescingOptions& options);
+    CoalescingOptions getCoalescing();
+
+    /// Queue capacities in messages (rounded up to a power of two). Only before connect();
+    /// returns false once connected. When a queue is full the newest message is dropped
+    /// and counted.
+    bool setQueueCapacity(size_t outgoing, size_t incoming);
+    size_t getDroppedOutgoingCount() const { return droppedOutgoing_.load(); }
+    /// Outgoing limits and full-queue policy (default: DropNewest at queue capacity).
+    void setBackpressure(const BackpressureOptions& options);
+    BackpressureOptions getBackpressure();
+    /// Queue depth for producers that throttle themselves. Approximate while the writer runs.
+    size_t getOutgoingQueueDepth() const { return outgoing_buffer_->size(); }
+    size_t getOutgoingQueueBytes() const { return outgoingBytes_.load(); }
+    /// True from the moment a high-water mark rejects/blocks a send until the queue is back below low water.
+    bool isBackpressured() const { return backpressured_.load(); }
+    size_t getDroppedIncomingCount() const { return droppedIncoming_.load(); }
+
+    /// <summary>
+    /// Block until received messages/frames are queued, up to timeout_ms (-1 = no timeout).
+    /// Returns true if something can be received. Also returns on disconnect().
+    /// </summary>
+    bool waitForMessages(int timeout_ms);
+
+    /// <summary>
+    /// Callback delivery (register before connect). The I/O thread calls it as soon
+    /// as a message/frame is parsed, instead of queueing it for receive(); the view
+    /// or bytes are only valid during the call. Keep callbacks short: they run on the
+    /// I/O thread. onMessage is for Delimited framing, onBinaryMessage for the binary ones.
+    /// </summary>
+    void onMessage(MessageCallback callback) { messageCallback_ = std::move(callback); }
+    void onBinaryMessage(BinaryMessageCallback callback) { binaryMessageCallback_ = std::move(callback); }
+    /// Timing of the message being handed to a callback right now. Only meaningful
+    /// inside onMessage/onBinaryMessage (I/O thread).
+    const RxTiming& currentRxTiming() const { return rxTiming_; }
+
+    void setReconnect(const ReconnectOptions& options);
+    ReconnectOptions getReconnect();
+
+    void setLiveness(const LivenessOptions& options);
+    LivenessOptions getLiveness();
+    LivenessStatus getLivenessStatus();
 
     bool isConnected();
     void clearInBuffer();
@@ -56,18 +311,83 @@ public:
     static std::vector<std::string> splitMessage(const std::string& message, const std::string& delimiter, std::string& remainder, bool appendRemainder = true);
 
     bool suppressCatchPrints = true;
-    int missedHeartbeatLimit = 50;
+    int missedHeartbeatLimit = 50;   // only used for the default liveness timeout
+
+    /// <summary>
+    /// Event-driven I/O (async mode only, set before connect).
+    /// Instead of polling every period_ms, the serial thread runs io_context_
+    /// with async_read_some/async_write: the socket is drained until would_block
+    /// as soon as data arrives and send() flushes immediately.
+    /// period_ms then only sets the heartbeat tick.
+    /// </summary>
+    bool eventDriven = false;
+
+    /// <summary>
+    /// Kernel receive timestamps (set before connect). On Linux each read then also
+    /// fetches SO_TIMESTAMPNS, when the kernel took the data in, and RxTiming::kernel
+    /// is filled in. Reads go through recvmsg (event-driven mode waits for
+    /// readability and reads itself). No effect elsewhere.
+    /// </summary>
+    bool kernelTimestamps = false;
+
+    Framing framing = Framing::Delimited;
+    // Largest accepted binary payload. In LengthPrefixedCRC mode a larger length is treated
+    // as a false sync; in LengthPrefixed mode it drops the connection.
+    uint32_t maxFramePayload = 16 * 1024 * 1024;
+    // LengthPrefixedCRC: a sync whose length exceeds this is dropped as a false sync
+    // once a complete valid frame follows it, instead of waiting for all its bytes.
+    size_t frameLookAhead = FrameParser::DEFAULT_LOOK_AHEAD;
 
 private:
     void connectionThread();
     void serialThread();
+    void ioThread();
 
     void doConnection();
     void doSerial();
+    bool openSocket();
+    int nextBackoff_ms(int failures);
+    void notifyState();
 
     void sendMessages();
     void readMessages();
+    boost::asio::mutable_buffer prepareRead();
+    size_t readSome(boost::system::error_code& ec);
+    void handleIncoming(size_t bytes_read);
+    void handleControl(int type, uint32_t seq);
+    void notifyReceived();
+    bool hasReceived();
+    int popFrame(BinaryMessage& frame);
+
+    // Batched send helpers shared by both modes
+    template <typename Fill>
+    int enqueueOutgoing(size_t bytes, Fill&& fill);
+    int makeRoom();
+    bool dropOldest();
+    void releaseBackpressure();
+    void noteQueued(size_t bytes);
+    void postFlush();
+    int takeOutgoing(bool force);
+    size_t buildBatch();
+    bool writeSequence();
+    size_t writeSome(size_t first, boost::system::error_code& ec);
+    void waitWritable(boost::system::error_code& ec);
+    void applySocketOptions();
+    void resetLiveness();
+    int keepaliveInterval_ms();
+    int livenessTimeout_ms();
+    bool keepaliveDue(int64_t now);
+    const std::string& buildKeepalive(int64_t now);
+    static int64_t nowTicks();
 
+    // Event-driven handlers (run on the io thread)
+    void startRead();
+    void handleRead(const boost::system::error_code& error, size_t bytes_read);
+    void startWrite(bool heartbeat = false, bool uncork = false);
+    void armCork(int window_us);
+    void handleWrite(const boost::system::error_code& error);
+    void startHeartbeat(int delay_ms);
+    void handleHeartbeat(const boost::system::error_code& error);
 
     void closeSocket();
 };
@@ -0,0 +1,164 @@
+#ifndef SOCKET_SERVER_H
+#define SOCKET_SERVER_H
+
+#include <boost/asio.hpp>
+#include <atomic>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "Socket_Serial.h"
+#include "StreamParser.h"
+
+class Socket_Server;
+
+/// <summary>
+/// One accepted client of a Socket_Server.
+/// send()/receive() behave like Socket_Serial's: messages are delimiter-framed
+/// strings, empty messages are heartbeats, receive(-1) takes everything queued.
+/// Liveness follows the server's Socket_Serial::LivenessOptions: keepalives on an
+/// idle link, a wall-clock receive timeout, and optionally RTT pings.
+/// All socket work runs on the session's strand of the server's io_context.
+/// Sessions must not be used after their server has been destroyed.
+/// </summary>
+class Socket_Session : public std::enable_shared_from_this<Socket_Session> {
+public:
+    typedef std::shared_ptr<const std::string> SharedMessage;
+
+    Socket_Session(int _id, boost::asio::ip::tcp::socket socket, Socket_Server& _server);
+
+    int id() const { return id_; }
+    const std::string& remoteAddress() const { return remoteAddress_; }
+    bool isConnected() { return connectedFlag; }
+
+    void send(const std::string& msg);
+    /// Shared payload, used by broadcast so one message is stored once for every session.
+    void send(const SharedMessage& msg);
+    std::vector<std::string> receive(int count = -1);
+
+    void clearInBuffer();
+    void clearOutBuffer();
+    void close();
+
+    Socket_Serial::LivenessStatus getLivenessStatus();
+
+private:
+    friend class Socket_Server;
+
+    void start();
+    void postFlush();
+
+    void startRead();
+    void handleRead(const boost::system::error_code& error, size_t bytes_read);
+    void handleIncoming(size_t bytes_read);
+    void startWrite(bool heartbeat = false);
+    void handleWrite(const boost::system::error_code& error);
+    void startHeartbeat(int delay_ms);
+    void handleHeartbeat(const boost::system::error_code& error);
+    void handlePong(uint32_t seq);
+    const std::string& buildKeepalive(int64_t now);
+    void closeSocket();
+
+    int id_;
+    Socket_Server& server_;
+    boost::asio::ip::tcp::socket socket_;
+    boost::asio::steady_timer heartbeat_timer_;
+    std::string remoteAddress_;
+
+    std::mutex in_buffer_mutex_;
+    std::mutex out_buffer_mutex_;
+    std::vector<std::string> incoming_buffer_;
+    std::vector<SharedMessage> outgoing_buffer_;
+
+    // Strand-only state
+    DelimiterParser parser_;
+    std::vector<SharedMessage> writing_buffer_;
+    size_t writeIndex_ = 0;
+    std::vector<boost::asio::const_buffer> write_sequence_;
+    bool writeInProgress_ = false;
+    uint32_t pingSeq_ = 0;
+    int64_t pingSentTime_ = 0;                    // 0 = no ping outstanding
+    std::string keepaliveBytes_;                  // the keepalive being written
+
+    // Liveness. Times are steady_clock ticks; written on the strand, readable anywhere.
+    std::atomic<int64_t> lastReceiveTime_{0};
+    std::atomic<int64_t> lastSendTime_{0};
+    std::atomic<int64_t> rttLast_ns_{-1};
+    std::atomic<int64_t> rttSmoothed_ns_{-1};
+    std::atomic<int64_t> rttMin_ns_{-1};
+    std::atomic<uint64_t> rttSamples_{0};
+    std::atomic<uint64_t> keepalivesSent_{0};
+
+    std::atomic<bool> connectedFlag{true};
+    std::atomic<bool> flushPosted_{false};
+};
+
+/// <summary>
+/// Multi-client TCP server. Keeps the acceptor open and gives every client its
+/// own Socket_Session with separate incoming/outgoing queues. All sessions share
+/// one io_context driven by threadCount worker threads, so a single process can
+/// serve many peers with a fixed number of threads.
+/// Wire format and heartbeat contract match Socket_Serial, so existing
+/// Socket_Serial clients connect unchanged. Only Delimited framing is supported:
+/// clients must leave Socket_Serial::framing at Framing::Delimited.
+/// </summary>
+class Socket_Server {
+public:
+    Socket_Server(const std::string& _IP_Address, const std::string& _port, int _threadCount = 1);
+    ~Socket_Server();
+
+    /// Bind, listen and start the worker threads. period_ms is the heartbeat tick.
+    /// Returns false if the endpoint could not be bound.
+    bool start(int _period_ms);
+    void stop();
+    bool isListening() { return listeningFlag; }
+
+    /// Returns false if no such client is connected.
+    bool send(int clientId, const std::string& msg);
+    void broadcast(const std::string& msg);
+    /// A client that disconnected stays in getClientIds() until receive() has
+    /// taken the messages it sent before closing; then it is removed.
+    std::vector<std::string> receive(int clientId, int count = -1);
+
+    std::shared_ptr<Socket_Session> getSession(int clientId);
+    std::vector<int> getClientIds();
+    size_t clientCount();
+
+    bool suppressCatchPrints = true;
+    int missedHeartbeatLimit = 50;   // only used for the default liveness timeout
+    // Same meaning as Socket_Serial::setLiveness(), for every session (set before start()).
+    Socket_Serial::LivenessOptions liveness;
+    bool tcpNoDelay = true;
+    size_t maxBatchBytes = 256 * 1024;
+
+private:
+    friend class Socket_Session;
+
+    void startAccept();
+    void handleAccept(const boost::system::error_code& error, boost::asio::ip::tcp::socket socket);
+    void removeSession(int clientId);
+    int keepaliveInterval_ms() const;
+    int livenessTimeout_ms() const;
+
+    boost::asio::io_context io_context_;
+    boost::asio::ip::tcp::acceptor acceptor_;
+    std::unique_ptr<boost::asio::executor_work_guard<boost::asio::io_context::executor_type>> work_;
+    std::vector<std::thread> worker_threads_;
+
+    std::mutex sessions_mutex_;
+    std::map<int, std::shared_ptr<Socket_Session>> sessions_;
+    int nextClientId = 1;
+
+    std::atomic<bool> listeningFlag{false};
+    std::string msgDelimiter = ";";
+
+    std::string IP_Address;
+    std::string port;
+    int threadCount;
+    int period_ms = 10;
+};
+
+#endif // SOCKET_SERVER_H
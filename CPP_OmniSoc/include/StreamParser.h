@@ -0,0 +1,242 @@
+#ifndef OMNISOC_STREAM_PARSER_H
+#define OMNISOC_STREAM_PARSER_H
+
+#include <boost/asio/buffer.hpp>
+#include <boost/utility/string_view.hpp>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include <vector>
+
+// Persistent receive buffer for stream transports. Reads land directly in the
+// free tail (prepare/commit, like asio::streambuf), parsers consume from the
+// front. Storage is reused across reads: the only copy is moving a partial
+// trailing message to the front when the tail runs out of room, so the cost
+// is bounded by one message rather than by the whole backlog.
+class ReceiveBuffer {
+public:
+    explicit ReceiveBuffer(size_t initialCapacity = 64 * 1024);
+
+    // Writable region of at least minSize bytes for the next read.
+    boost::asio::mutable_buffer prepare(size_t minSize);
+    // Mark n bytes of the last prepare() region as received.
+    void commit(size_t n);
+
+    const char* data() const { return storage_.data() + head_; }
+    size_t size() const { return tail_ - head_; }
+
+    // Drop n bytes from the front. Resets to the start of storage when empty.
+    void consume(size_t n);
+    void clear();
+
+private:
+    std::vector<char> storage_;
+    size_t head_ = 0;
+    size_t tail_ = 0;
+};
+
+// Incremental delimiter splitter over a ReceiveBuffer. Replaces the
+// copy/substr/erase approach of Socket_Serial::splitMessage on the hot path:
+//   - delimiters are located with memchr (vectorized in every mainstream libc)
+//     and a memcmp for the rest of a multi-byte delimiter,
+//   - messages are handed out as views into the buffer, so callers only copy
+//     what they keep,
+//   - a message or delimiter split across reads simply stays in the buffer;
+//     scanning resumes where it stopped instead of re-searching or concatenating.
+class DelimiterParser {
+public:
+    explicit DelimiterParser(const std::string& delimiter = ";", size_t initialCapacity = 64 * 1024);
+
+    boost::asio::mutable_buffer prepare(size_t minSize = 16 * 1024) { return buffer_.prepare(minSize); }
+    void commit(size_t n) { buffer_.commit(n); }
+
+    // Calls onMessage(boost::string_view) for every complete message, in order,
+    // including empty ones (bare delimiters). The view is only valid for the
+    // duration of the call. Returns the number of messages delivered.
+    template <typename Handler>
+    size_t parse(Handler&& onMessage);
+
+    // Bytes received after the last delimiter (an incomplete message).
+    boost::string_view remainder() const { return boost::string_view(buffer_.data(), buffer_.size()); }
+
+    const std::string& delimiter() const { return delimiter_; }
+    void reset();
+
+private:
+    const char* findDelimiter(const char* from, const char* end) const;
+
+    ReceiveBuffer buffer_;
+    std::string delimiter_;
+    // Bytes at the front of buffer_ already searched without finding a delimiter.
+    size_t scanned_ = 0;
+};
+
+template <typename Handler>
+size_t DelimiterParser::parse(Handler&& onMessage) {
+    const size_t delimLen = delimiter_.size();
+    const char* begin = buffer_.data();
+    const char* end = begin + buffer_.size();
+
+    // A delimiter may straddle the previous scan boundary; back up just enough to catch it.
+    size_t resume = scanned_ >= delimLen ? scanned_ - (delimLen - 1) : 0;
+    const char* msgStart = begin;
+    const char* pos = begin + resume;
+    size_t count = 0;
+
+    while (const char* hit = findDelimiter(pos, end)) {
+        onMessage(boost::string_view(msgStart, hit - msgStart));
+        ++count;
+        msgStart = hit + delimLen;
+        pos = msgStart;
+    }
+
+    size_t consumed = msgStart - begin;
+    scanned_ = buffer_.size() - consumed;
+    buffer_.consume(consumed);
+    return count;
+}
+
+// Incremental parser for Socket_Serial's binary framing modes:
+//   plain: [hdr:1][len:4 LE][bytes:len]
+//   crc:   [0xA5][0x5A][hdr:1][len:4 LE][bytes:len][crc16_lo][crc16_hi]
+// The crc layout is UART v3 with a 32-bit length; CRC-16/CCITT-FALSE covers
+// [hdr][len][bytes], sync excluded. In crc mode a bad CRC or an implausible
+// length is treated as a false sync and the scan resumes one byte later, like
+// the UART parser. A candidate longer than lookAhead is only waited for while
+// no complete, CRC-valid frame turns up in the bytes after its header; once one
+// does, the candidate is taken for a false sync, so a stray A5 5A with a large
+// length field can't hold up real frames for up to maxPayload bytes. (A large
+// frame whose payload itself carries crc-framed data can be misjudged this way.)
+// In plain mode there is nothing to resync on, so an oversized length is
+// reported as a stream error.
+// Payloads are handed out as pointers into the receive buffer (zero copy).
+class FrameParser {
+public:
+    static constexpr uint8_t SYNC_0 = 0xA5;
+    static constexpr uint8_t SYNC_1 = 0x5A;
+    static constexpr size_t PLAIN_OVERHEAD = 1 + 4;        // hdr + len
+    static constexpr size_t CRC_OVERHEAD = 2 + 1 + 4 + 2;  // sync + hdr + len + crc
+    static constexpr size_t DEFAULT_LOOK_AHEAD = 4096;
+
+    explicit FrameParser(bool withCrc = false, size_t maxPayload = 16 * 1024 * 1024, size_t initialCapacity = 64 * 1024);
+
+    void configure(bool withCrc, size_t maxPayload, size_t lookAhead = DEFAULT_LOOK_AHEAD);
+    bool withCrc() const { return crc_; }
+    size_t maxPayload() const { return maxPayload_; }
+
+    boost::asio::mutable_buffer prepare(size_t minSize = 16 * 1024) { return buffer_.prepare(minSize); }
+    void commit(size_t n) { buffer_.commit(n); }
+
+    // Calls onFrame(uint8_t header, const uint8_t* bytes, size_t len) for every
+    // complete valid frame; bytes are only valid for the duration of the call.
+    // Returns the number of frames delivered, or -1 on a plain-mode stream error.
+    template <typename Handler>
+    int parse(Handler&& onFrame);
+
+    // Frames skipped because of a CRC mismatch or an implausible length (crc mode).
+    size_t droppedFrames() const { return dropped_; }
+    // Bytes received but not parsed yet (the start of an incomplete frame).
+    size_t buffered() const { return buffer_.size(); }
+    void reset();
+
+    // Serialize one frame in the given layout, appending to out.
+    static void encode(std::string& out, bool withCrc, uint8_t header, const uint8_t* bytes, uint32_t len);
+
+private:
+    static uint32_t readLength(const uint8_t* p) {
+        return (uint32_t)p[0] | ((uint32_t)p[1] << 8) | ((uint32_t)p[2] << 16) | ((uint32_t)p[3] << 24);
+    }
+    static bool checkCrc(const uint8_t* hdr, size_t len);
+    // True if a complete valid frame starts after the header of the candidate at
+    // `frame` (crc mode). Resumes from parkedScan_, so a parked candidate's bytes
+    // are only scanned once.
+    bool laterFrame(const uint8_t* frame, size_t available);
+
+    ReceiveBuffer buffer_;
+    bool crc_;
+    size_t maxPayload_;
+    size_t lookAhead_ = DEFAULT_LOOK_AHEAD;
+    size_t dropped_ = 0;
+    // Offset (from the parked candidate at the buffer head) where laterFrame() resumes.
+    size_t parkedScan_ = 0;
+};
+
+template <typename Handler>
+int FrameParser::parse(Handler&& onFrame) {
+    const uint8_t* data = reinterpret_cast<const uint8_t*>(buffer_.data());
+    const size_t size = buffer_.size();
+    size_t pos = 0;
+    int count = 0;
+    bool parked = false;
+
+    while (pos < size) {
+        size_t remaining = size - pos;
+
+        if (!crc_) {
+            if (remaining < PLAIN_OVERHEAD) { break; }
+            uint32_t len = readLength(data + pos + 1);
+            if (len > maxPayload_) {
+                buffer_.consume(pos);
+                return -1;
+            }
+            if (remaining < PLAIN_OVERHEAD + len) { break; }
+            onFrame(data[pos], data + pos + PLAIN_OVERHEAD, static_cast<size_t>(len));
+            ++count;
+            pos += PLAIN_OVERHEAD + len;
+            continue;
+        }
+
+        const uint8_t* hit = static_cast<const uint8_t*>(std::memchr(data + pos, SYNC_0, remaining));
+        if (hit == nullptr) {
+            pos = size;
+            break;
+        }
+        pos = hit - data;
+        remaining = size - pos;
+
+        if (remaining < 2) { break; }
+        if (data[pos + 1] != SYNC_1) {
+            ++pos;
+            continue;
+        }
+        if (remaining < 2 + 1 + 4) { break; }
+
+        uint32_t len = readLength(data + pos + 3);
+        if (len > maxPayload_) {
+            // Implausible length — false sync.
+            ++dropped_;
+            ++pos;
+            continue;
+        }
+        if (remaining < CRC_OVERHEAD + len) {
+            // Stay parked on this sync until the rest arrives, unless it is long
+            // and real frames are already complete behind it.
+            if (pos != 0) { parkedScan_ = 0; }   // a new candidate, not the parked one
+            if (len > lookAhead_ && laterFrame(data + pos, remaining)) {
+                ++dropped_;
+                ++pos;
+                parkedScan_ = 0;
+                continue;
+            }
+            parked = true;
+            break;
+        }
+
+        if (!checkCrc(data + pos + 2, len)) {
+            ++dropped_;
+            ++pos;
+            continue;
+        }
+
+        onFrame(data[pos + 2], data + pos + 7, static_cast<size_t>(len));
+        ++count;
+        pos += CRC_OVERHEAD + len;
+    }
+
+    if (!parked) { parkedScan_ = 0; }
+    buffer_.consume(pos);
+    return count;
+}
+
+#endif // OMNISOC_STREAM_PARSER_H
@@ -0,0 +1,28 @@
+#ifndef OMNISOC_SYNCSCAN_H
+#define OMNISOC_SYNCSCAN_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+// Finds every offset i in data[0..len) with data[i] == first && data[i + 1] == second,
+// in increasing order, stopping after maxOut hits. Returns the number written to out.
+// Used by the UART frame parser to collect sync-pair ([0xA5][0x5A]) candidates in bulk
+// instead of stepping one byte at a time after each false sync.
+// Uses the widest engine the CPU supports (picked once, on first call).
+size_t sync_scan(const uint8_t* data, size_t len, uint8_t first, uint8_t second,
+                 size_t* out, size_t maxOut);
+
+// Individual engines, all returning identical results:
+//   Scalar — memchr for `first`, then checks the next byte.
+//   Sse2   — compares 16 positions per step (x86).
+//   Avx2   — compares 32 positions per step (x86 with AVX2).
+enum class SyncScanEngine { Scalar, Sse2, Avx2 };
+
+bool sync_scan_engine_supported(SyncScanEngine engine);
+SyncScanEngine sync_scan_active_engine();
+const char* sync_scan_engine_name(SyncScanEngine engine);
+// Runs `engine` directly; an unsupported engine falls back to the active one.
+size_t sync_scan_engine(SyncScanEngine engine, const uint8_t* data, size_t len,
+                        uint8_t first, uint8_t second, size_t* out, size_t maxOut);
+
+#endif // OMNISOC_SYNCSCAN_H
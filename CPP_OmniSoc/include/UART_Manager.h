@@ -0,0 +1,131 @@
+#ifndef UART_MANAGER_H
+#define UART_MANAGER_H
+
+#include <boost/asio.hpp>
+#include <atomic>
+#include <condition_variable>
+#include <functional>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "LockfreeQueue.h"
+#include "UART_Serial.h"
+
+/// <summary>
+/// Many UART ports on one event loop. Every port is a UART_Serial on the manager's
+/// shared io_context, which threadCount worker threads run: reads from all ports
+/// wake the same epoll loop and parse on whichever worker picks them up, instead of
+/// one read thread per port. Each port keeps its own parser, receive ring, TX
+/// scheduler and counters. Ports open and close at any time and are named by an
+/// int id (from 1, never reused).
+/// Received frames from every port land in one queue tagged with their port id, or
+/// go to onMessage() on the worker thread. Per-port features (onHeader(), large
+/// messages, QoS, ...) are set up on the UART_Serial itself in openPort()'s setup.
+/// </summary>
+class UART_Manager {
+public:
+    typedef std::function<void(int portId, uint8_t header, const uint8_t* bytes, uint8_t len)> MessageCallback;
+    // Runs on the new port before connect(): the place for setReadProfile(),
+    // onHeader(), setTxBackpressure() and the like.
+    typedef std::function<void(UART_Serial& serial)> PortSetup;
+
+    struct Frame {
+        int portId;
+        UART_Serial::Frame frame;
+    };
+
+    struct PortStats {
+        std::string device;
+        bool connected = false;
+        size_t framesReceived = 0;      // for the combined queue or onMessage(), drops included
+        size_t droppedBytes = 0;        // receive ring overflow
+        size_t droppedFrames = 0;       // the port's own queue (onHeader() setups)
+        size_t outgoingDepth = 0;
+        size_t droppedOutgoing = 0;
+    };
+
+    static constexpr size_t RX_QUEUE_DEPTH = 4096;
+
+    explicit UART_Manager(int _threadCount = 1);
+    ~UART_Manager();
+
+    UART_Manager(const UART_Manager&) = delete;
+    UART_Manager& operator=(const UART_Manager&) = delete;
+
+    // Tagged callback delivery instead of the queue (set before the first openPort()).
+    // Runs on a worker thread, `bytes` valid during the call; ports run in parallel
+    // with more than one worker. Don't close ports from it. The frame's timing is
+    // getPort(portId)->currentRxTiming() during the call.
+    void onMessage(MessageCallback callback) { messageCallback_ = std::move(callback); }
+
+    // Opens and connects a port. Returns its id, or -1 if the device didn't open.
+    int openPort(const std::string& device, unsigned int baud_rate, int timeoutPeriod_ms,
+                 const PortSetup& setup = PortSetup(), bool tx_pacing_enabled = true);
+    // Flushes and closes a port. Returns false if there is no such port.
+    bool closePort(int portId);
+    void closeAll();
+
+    // The port itself, for anything the manager doesn't wrap. Null if unknown; stays
+    // valid (but disconnected) if the port is closed meanwhile. Don't use it after
+    // the manager is destroyed, and don't reconnect it.
+    std::shared_ptr<UART_Serial> getPort(int portId);
+    std::vector<int> getPortIds();
+    size_t portCount();
+
+    // UART_Serial::sendMessage() on the port; -1 if there is no such port.
+    int sendMessage(int portId, uint8_t header, const uint8_t* bytes, uint8_t len);
+
+    // Combined receive queue, in arrival order per port. Returns 1 and fills `out`,
+    // or -1 if nothing is waiting. out.frame.timing is stamped by the port;
+    // dispatched is when it came off this queue.
+    int receiveMessage(Frame& out);
+    // Drains up to maxFrames queued frames into frames[]; returns how many.
+    size_t receiveMessages(Frame* frames, size_t maxFrames);
+    // Blocks until the queue has a frame, up to timeout_ms (-1 = no timeout), or
+    // until closeAll() (also run by the destructor). Returns true if a frame is queued.
+    bool waitForMessages(int timeout_ms);
+    // Frames lost because the combined queue was full.
+    size_t getDroppedFramesCount() const { return dropped_.load(); }
+
+    // Returns false if there is no such port.
+    bool getPortStats(int portId, PortStats& out);
+
+private:
+    // getPort() hands out aliases of the Port, so the port's callbacks (which point
+    // at it) stay valid as long as the UART_Serial does.
+    struct Port {
+        int id = 0;
+        std::string device;
+        std::unique_ptr<UART_Serial> serial;
+        std::atomic<size_t> frames{0};
+    };
+
+    void deliver(Port& port, uint8_t header, const uint8_t* bytes, uint8_t len);   // worker thread
+    std::shared_ptr<Port> findPort(int portId);
+
+    boost::asio::io_context io_context_;
+    std::unique_ptr<boost::asio::executor_work_guard<boost::asio::io_context::executor_type>> work_;
+    std::vector<std::thread> worker_threads_;
+
+    std::mutex ports_mutex_;
+    std::map<int, std::shared_ptr<Port>> ports_;
+    int nextPortId = 1;
+
+    // Workers push, receive calls pop under rx_mutex_ (the single consumer side).
+    // rxWaiters_ lets workers skip the notify while nobody waits. closes_ counts
+    // closeAll() calls (under rx_wait_mutex_), which end every wait.
+    MessageCallback messageCallback_;
+    MPSCQueue<Frame> rxQueue_{RX_QUEUE_DEPTH};
+    std::mutex rx_mutex_;
+    std::atomic<size_t> dropped_{0};
+    std::atomic<int> rxWaiters_{0};
+    std::mutex rx_wait_mutex_;
+    std::condition_variable rx_wait_cv_;
+    uint64_t closes_ = 0;
+};
+
+#endif // UART_MANAGER_H
@@ -2,31 +2,146 @@
 #define UART_SERIAL_H
 
 #include <boost/asio.hpp>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <functional>
 #include <iostream>
+#include <memory>
 #include <vector>
 #include <thread>
 #include <mutex>
 #include <atomic>
 
+#include "Backpressure.h"
+#include "Fragmentation.h"
+#include "LockfreeQueue.h"
+#include "RxTiming.h"
+
 class UART_Serial {
 public:
+    typedef std::function<void(uint8_t header, const uint8_t* bytes, uint8_t len)> MessageCallback;
+    typedef std::function<void(uint8_t header, const uint8_t* bytes, size_t len)> LargeMessageCallback;
+    typedef FragmentReassembler::Chunk LargeChunk;
+    typedef std::function<void(const LargeChunk& chunk)> LargeStreamCallback;
+
+    // How the read thread trades wakeups for latency (set before connect()).
+    //   Batched:    after each read, wait ~5 byte times before reading again so the
+    //               next read returns a batch. Bytes already read are published at once.
+    //   LowLatency: re-arm the read immediately, wake on every byte (VMIN=1, VTIME=0)
+    //               and ask the driver for ASYNC_LOW_LATENCY (Linux, where supported).
+    enum class ReadProfile { Batched, LowLatency };
+
+    // TX priority lanes, most urgent first. The scheduler always writes the most
+    // urgent pending frame next; lower lanes only get the link when higher ones
+    // are empty. Every header starts in Normal.
+    enum class TxPriority : uint8_t { Urgent, High, Normal, Bulk };
+
+    // Line flow control (set before connect()).
+    //   None:   no handshake; TX pacing against the baud clock protects the receiver.
+    //   RtsCts: hardware handshake. The UART stops sending while the peer drops CTS,
+    //           so the driver does the backpressure and TX pacing is turned off.
+    enum class FlowControl { None, RtsCts };
+
     UART_Serial(const std::string& port, unsigned int baud_rate, int timeoutPeriod_ms,
                 bool tx_pacing_enabled = true);
+    // Shared loop: no read thread of its own. The read side runs as handlers on
+    // `context` (on a strand, so never concurrently for this port), for whoever runs
+    // it to drive, e.g. UART_Manager's workers. Callbacks run on those threads. The
+    // context must keep running until disconnect() returns.
+    UART_Serial(boost::asio::io_context& context, const std::string& port, unsigned int baud_rate,
+                int timeoutPeriod_ms, bool tx_pacing_enabled = true);
     ~UART_Serial();
 
     void connect();
     void disconnect();
     bool isConnected();
     size_t available();
+    // The requested rate. Rates without a standard termios constant (e.g. 250000,
+    // 3500000) are set through termios2/BOTHER on Linux; getActualBaudRate() is
+    // what the driver reports after connect() (0 before).
+    unsigned int getBaudRate() const { return baud_rate_; }
+    unsigned int getActualBaudRate() const { return actualBaud_; }
+    void setFlowControl(FlowControl mode) { flowControl_ = mode; }
+    FlowControl getFlowControl() const { return flowControl_; }
+    // Driver-side buffers (before connect(); returns false while connected; 0 leaves
+    // one as it is). On Windows both go to SetupComm() as the driver's queue sizes.
+    // Linux/macOS tty buffers are fixed, so rxBytes sizes the receive ring instead
+    // (as setReceiveBufferSize()), and txBytes caps what the TX scheduler leaves in
+    // the kernel's output queue when pacing is off (RtsCts or tx_pacing_enabled
+    // false): frames wait in the priority lanes rather than behind a deep FIFO.
+    bool setDriverBufferSizes(size_t rxBytes, size_t txBytes);
+
+    void setReadProfile(ReadProfile profile) { readProfile_ = profile; }
+    ReadProfile getReadProfile() const { return readProfile_; }
+
+    // Per-header TX QoS (set before connect()): the priority lane, and whether only
+    // the latest value matters. With latestValue, a frame replaces one with the same
+    // header that hasn't been written yet (one pending frame per header, never
+    // rejected), so stale telemetry never uses link time. Returns 1, or -1 for a
+    // reserved header (BUNDLE_HEADER, FRAGMENT_HEADER, RELIABLE_HEADER,
+    // CREDIT_HEADER), whose QoS the link sets itself.
+    int setHeaderQos(uint8_t header, TxPriority priority, bool latestValue = false);
+    // TX queue limits and full-queue policy, applied to each priority lane
+    // separately (set before connect()). Defaults: the whole queue, DropNewest.
+    // DropOldest evicts the lane's oldest queued frames to make room; a frame the
+    // scheduler has already taken for a write can't be evicted, so when nothing
+    // else is queued the new frame is dropped instead.
+    void setTxBackpressure(const BackpressureOptions& options) { txBackpressure_ = options; }
+    BackpressureOptions getTxBackpressure() const { return txBackpressure_; }
+    // Bytes a write may run ahead of the baud-rate clock when pacing is on (set
+    // before connect()). Size it to the receiver's HW RX buffer; frames are packed
+    // back to back into one write up to this budget.
+    void setTxBurstBytes(size_t bytes) { txBurstBytes_ = bytes; }
+    // Blocks until every queued frame has been written, up to timeout_ms (-1 = no
+    // timeout). Returns true if the queue drained. disconnect() calls this first.
+    bool flushOutgoing(int timeout_ms);
+    size_t getOutgoingQueueDepth() const;
+    size_t getDroppedOutgoingCount() const { return txDropped_.load(); }
+    // Latest-value frames replaced by a newer one before they were written.
+    size_t getCoalescedOutgoingCount() const { return txCoalesced_.load(); }
+    // Bundling (set before connect()): small frames written back to back are packed
+    // into one BUNDLE_HEADER frame, saving 4 bytes of framing per extra message.
+    // When the link is idle, a non-Urgent frame waits up to window_us for company.
+    // Off by default: the peer must unpack bundles (UART_Serial and Arduino
+    // SerialManager do, in receiveMessage()).
+    void setTxBundling(bool enabled, int window_us = 500) { txBundling_ = enabled; txBundleWindow_us_ = window_us; }
+    // Messages that went out inside a bundle.
+    size_t getBundledOutgoingCount() const { return txBundled_.load(); }
+    // Credit flow control (set before connect(); enable it on both ends). Each side
+    // advertises its free receive space in CREDIT_HEADER frames, when it has grown
+    // by a quarter of the receive ring and every CREDIT_REFRESH_MS, and writes only
+    // within the peer's latest grant instead of pacing against the baud clock, so
+    // the send rate follows how fast the peer actually drains: a fast host takes
+    // whole bursts, a busy Arduino loop() holds the sender back. Until the first
+    // grant arrives, or when none has come for CREDIT_TIMEOUT_MS while waiting for
+    // one, the baud-rate pacing above applies. Turns on dispatch mode, as credits
+    // are read by the read thread.
+    void setCreditFlowControl(bool enabled) { creditEnabled_ = enabled; }
+    bool getCreditFlowControl() const { return creditEnabled_; }
+    // True while writes follow the peer's grants.
+    bool isCreditActive() const { return creditActive_.load(); }
+    // Times the scheduler had a frame ready but had to wait for credit.
+    size_t getCreditStallCount() const { return creditStalls_.load(); }
+
+    // Receive ring capacity in bytes (rounded up to a power of two, at least
+    // 2 * MAX_FRAME_SIZE). Only before connect(); returns false while connected.
+    bool setReceiveBufferSize(size_t bytes);
+    size_t getReceiveBufferSize() const { return rx_ring_->capacity(); }
 
-    // User-callable reset: drops the internal scan buffer and the kernel
-    // UART input buffer, resets scan position. Use after mode switches or
+    // User-callable reset: drops the receive ring contents and the kernel
+    // UART input buffer. Use after mode switches or
     // when the application detects prolonged corruption and wants to start
     // fresh. Not used for automatic resync — CRC-16 handles that.
     void flushIncomingSerial();
 
     // Bytes-primary API (v3).
-    // sendMessage: returns 1 on success, -1 on failure (len > MAX_PAYLOAD or write error).
+    // sendMessage: encodes the frame and hands it to the TX scheduler thread, which
+    // paces it onto the wire; returns without waiting for the write. Returns 1 when
+    // queued, -1 if len > MAX_PAYLOAD or not connected, -2 if the queue is full
+    // (rejected or dropped per setTxBackpressure()), -3 if a Block wait timed out or
+    // the port disconnected. Write errors are reported on stderr.
     int sendMessage(uint8_t header, const uint8_t* bytes, uint8_t len);
     // receiveMessage: caller passes a MAX_PAYLOAD-sized buffer for `bytes`.
     // Returns 1 on a valid frame, negative on no-frame / partial / bad frame.
@@ -39,44 +154,240 @@ public:
     // Returns -6 if the received payload length is not a multiple of 4 bytes.
     int receiveMessage(uint8_t& header, float* data, uint8_t& numFloats);
 
-    // Diagnostic: count of bytes dropped due to internal buffer cap overflow.
+    // Blocks until unparsed bytes have arrived since receiveMessage() last ran out of
+    // frames, up to timeout_ms (-1 = no timeout). Returns true if receiveMessage() is
+    // worth calling; a true return may still yield a partial frame. Also returns on
+    // disconnect(). Replaces polling receiveMessage() with a sleep.
+    bool waitForMessages(int timeout_ms);
+
+    // Callback delivery (register before connect()). The read thread parses frames as
+    // soon as bytes arrive and calls this instead of leaving them for receiveMessage().
+    // `bytes` is only valid during the call. Runs on the read thread: keep it short and
+    // don't call receiveMessage() or flushIncomingSerial() from it. sendMessage() is fine.
+    // With onHeader() handlers registered this is the default handler for other headers.
+    void onMessage(MessageCallback callback) { messageCallback_ = std::move(callback); }
+
+    // Per-header dispatch (register before connect()). The read thread calls `handler`
+    // right after a frame with this header passes CRC, with `bytes` pointing into the
+    // receive ring (no copy), under the same rules as onMessage(). Headers without a
+    // handler go to onMessage() if set, otherwise to receiveMessage(). An empty handler
+    // unregisters. While any header handler is registered the read thread also skips
+    // its batching sleep, so handlers see a frame as soon as it is readable.
+    void onHeader(uint8_t header, MessageCallback handler);
+    // Sends frames with this header to receiveMessage()/receiveMessages() even when
+    // onMessage() is set. Clears any onHeader() handler for it.
+    void routeToQueue(uint8_t header);
+
+    // Large messages (up to MAX_LARGE_PAYLOAD bytes), split into FRAGMENT_HEADER frames.
+    // sendLargeMessage: queues every fragment on the header's lane, in order, and
+    // returns once they are all queued. Fragments wait for queue space whatever the
+    // backpressure policy (a message missing a fragment is lost whole), so a big
+    // message goes out at link speed. Returns 1, -1 if too long or not connected,
+    // -3 if a wait timed out (setTxBackpressure() blockTimeout_ms) or the port
+    // disconnected part-way. Fragments are never coalesced or bundled away.
+    int sendLargeMessage(uint8_t header, const uint8_t* bytes, size_t len);
+    // Pops one reassembled message: swaps it into `bytes` (the old contents of
+    // `bytes` are recycled as a reassembly buffer). Returns 1, or -1 if none is ready.
+    // Without callbacks, fragments are collected as receiveMessage() and
+    // receiveMessages() parse, and by this call itself up to the next ordinary frame.
+    // At most LARGE_QUEUE_DEPTH finished messages wait here; more are dropped.
+    int receiveLargeMessage(uint8_t& header, std::vector<uint8_t>& bytes);
+    // Callback delivery for reassembled messages (register before connect(); same
+    // rules as onMessage()). `bytes` is only valid during the call.
+    void onLargeMessage(LargeMessageCallback callback) { largeCallback_ = std::move(callback); }
+    // Streaming delivery for one header (register before connect(); same rules as
+    // onMessage()): chunks are handed out in order as fragments arrive, nothing is
+    // buffered. A lost fragment ends the message with an `aborted` chunk.
+    void onLargeStream(uint8_t header, LargeStreamCallback callback);
+    // Reassembly limits (before connect()): `slots` messages in progress at once, each
+    // at most maxBytes long, dropped timeout_ms after their last fragment. Memory is
+    // bounded by slots * maxBytes. Defaults: 4 slots, 64 KB, the connection timeout.
+    bool setLargeMessageLimits(size_t maxBytes, size_t slots, int timeout_ms);
+    // Diagnostic: large messages lost (timed out, too long, evicted, queue full).
+    size_t getDroppedLargeMessageCount();
+
+    // Diagnostic: count of received bytes dropped because the receive ring was full
+    // (the consumer fell behind). The newest bytes are dropped; CRC resyncs afterwards.
     size_t getDroppedBytesCount() const { return dropped_bytes_.load(); }
+    // Diagnostic: queued frames dropped because nobody drained the receive queue
+    // (dispatch mode only: onMessage() or onHeader() registered).
+    size_t getDroppedFramesCount() const { return dropped_frames_.load(); }
 
     static constexpr uint8_t MAX_PAYLOAD = 48;          // v3 max payload bytes per frame
     static constexpr uint8_t MAX_FLOATS  = MAX_PAYLOAD / 4;  // 12
+    // Reserved header: the payload is several messages, each [hdr:1][len:1][bytes].
+    // Unpacked by receiveMessage(); applications never see it and can't send it.
+    static constexpr uint8_t BUNDLE_HEADER = 0xFB;
+    // Reserved header: one fragment of a large message (see Fragmentation.h).
+    static constexpr uint8_t FRAGMENT_HEADER = 0xFC;
+    // Reserved header: ReliableChannel frames (ReliableChannel::HEADER).
+    static constexpr uint8_t RELIABLE_HEADER = 0xFD;
+    // Reserved header: a credit grant, [received:u32 LE][free:u16 LE][sent:u32 LE].
+    // The grant's sender has taken in `received` bytes of the link so far and has
+    // room for `free` more; `sent` is how many it wrote before this frame, so the
+    // receiver knows that much has arrived or been lost and counts lost bytes as
+    // received. Absolute counts, so a lost grant is made up by the next one.
+    static constexpr uint8_t CREDIT_HEADER = 0xFE;
+    static constexpr int CREDIT_REFRESH_MS = 100;
+    static constexpr int CREDIT_TIMEOUT_MS = 500;
+    static constexpr size_t MAX_LARGE_PAYLOAD = FRAGMENT_MAX_COUNT * (MAX_PAYLOAD - FRAGMENT_PREFIX) - FRAGMENT_LENGTH;
+    static constexpr size_t LARGE_QUEUE_DEPTH = 8;
+
+    // One received frame. rxTime is when the frame was drained from the receive ring
+    // (timing.parsed); timing has the full receive timeline (RxTiming.h). Frames
+    // unpacked from one bundle share the bundle's timing.
+    struct Frame {
+        uint8_t header;
+        uint8_t len;
+        uint8_t bytes[MAX_PAYLOAD];
+        std::chrono::steady_clock::time_point rxTime;
+        RxTiming timing;
+    };
+
+    // receiveMessage (timed): as receiveMessage() above, plus when the frame
+    // arrived, was parsed and was handed over in frame.timing.
+    int receiveMessage(Frame& frame);
+    // Timing of the frame being handed to an onMessage()/onHeader() handler right
+    // now. Only meaningful inside the handler (read thread).
+    const RxTiming& currentRxTiming() const { return rxTiming_; }
+
+    // Caller-owned batch for receiveMessages(). Records are allocated once here;
+    // a drain only overwrites them and sets count.
+    struct FrameBatch {
+        explicit FrameBatch(size_t capacity = 64) : frames(capacity), count(0) {}
+        size_t capacity() const { return frames.size(); }
+
+        std::vector<Frame> frames;
+        size_t count;
+    };
+
+    // Batch drain: extracts every complete frame buffered now (up to maxFrames and the
+    // batch capacity) under one lock acquisition, releasing the ring space once at the
+    // end. Returns the number of frames written to batch.frames (0 if none).
+    // Bad or partial frames are skipped/left exactly as receiveMessage() would.
+    int receiveMessages(FrameBatch& batch, size_t maxFrames = SIZE_MAX);
 
 private:
+    UART_Serial(boost::asio::io_context* shared, const std::string& port, unsigned int baud_rate,
+                int timeoutPeriod_ms, bool tx_pacing_enabled);
     void readFromSerial();
+    void startRead();
+    void readDone();
+    void handleRead(const boost::system::error_code& ec, std::size_t bytes_read, bool ringFull);
+    void configureLowLatency(int fd);
+    long driverRoomDelay_ns(size_t bytes);                         // TX thread only
+    void waitDriverRoom(size_t bytes);                             // TX thread only
+    struct TxFrame;
+    struct TxLane;
+    void encodeFrame(TxFrame& frame, uint8_t header, const uint8_t* bytes, uint8_t len);
+    void postLatest(uint8_t header, const uint8_t* bytes, uint8_t len);
+    void storeMailbox(const TxFrame& frame);                      // mailbox_mutex_ held
+    bool takeMailbox(int lane, TxFrame& out);
+    int queueFrame(TxLane& lane, uint8_t header, const uint8_t* bytes, uint8_t len, bool block);
+    int reserveTx(TxLane& lane, size_t size, bool block);
+    bool dropOldestTx(TxLane& lane);
+    void wakeTx();
+    int popTx(TxFrame& out);                                       // TX thread only
+    void putBackTx(const TxFrame& frame, int lane);                // TX thread only
+    void packedTx(const TxFrame& frame, int lane);
+    bool hasPendingTx() const;
+    bool bundleable(const TxFrame& frame) const;
+    void waitBundleWindow();
+    struct TxStep;
+    TxStep nextTxStep();                                           // TX thread only
+    void finishTxWrite(size_t bytes, const boost::system::error_code& ec);
+    void txScheduler();
+    void waitForTx();
+    void pumpTx();                                                 // tx_timer_'s strand
+    void parkTx(std::chrono::steady_clock::time_point until);      // tx_timer_'s strand
+    void kickTx();                                                 // tx_timer_'s strand
+    void writeTx();                                                // tx_timer_'s strand
+    void notifyTxSpace();
+    void advertiseCredit();
+    void takeCredit(const uint8_t* bytes, uint8_t len, size_t at = SIZE_MAX);  // buffer_mutex_ held
+    void stampCredit(uint8_t* frame, uint32_t sent);
+    long creditAllowance();                                         // TX thread only
+    bool takeCreditFrame(TxFrame& out);
+    void waitForCredit(uint32_t grants, uint32_t adverts);
+    int parseFrame(uint8_t& header, uint8_t* bytes, uint8_t& len);  // buffer_mutex_ held
+    int findFrame(size_t& start, uint8_t& header, uint8_t& len);    // buffer_mutex_ held
+    void dispatchFrames();                                           // buffer_mutex_ held
+    bool routeFrame(uint8_t header, const uint8_t* bytes, uint8_t len);  // buffer_mutex_ held
+    bool absorbFragment(const uint8_t* bytes, uint8_t len);             // buffer_mutex_ held
+    void completeLarge(uint8_t header, std::vector<uint8_t>& message);  // buffer_mutex_ held
+    void pumpFragments();                                            // buffer_mutex_ held
+    const MessageCallback* handlerFor(uint8_t header) const;
+    size_t popQueuedFrames(Frame* frames, size_t maxFrames);
+    bool hasReceived() const;
+    size_t drainFrames(Frame* frames, size_t maxFrames);            // buffer_mutex_ held
+    size_t nextSync(size_t available);                              // buffer_mutex_ held
+    size_t scanSync(size_t from, size_t available, size_t* out, size_t maxOut) const;
+    void consumeRx(size_t n);                                        // buffer_mutex_ held
+    void releaseRx();                                                // buffer_mutex_ held
+    void stampFrame(size_t start);                                   // buffer_mutex_ held
+    void resetArrivalMarks();                                        // buffer_mutex_ held
+    void resetSyncScan();                                            // buffer_mutex_ held
+    void checkTimeout();                                             // buffer_mutex_ held
+    void notifyReceived();
     void startWorkThreads();
     void stopWorkThreads();
 
-    boost::asio::io_context io_context_;
+    // The read thread runs io_context_: one async_read_some at a time into the
+    // receive ring, woken by the reactor the moment bytes are readable.
+    // read_timer_ paces the Batched profile and error retries. Both sit on one
+    // strand. On a shared context ownContext_ is null and there is no read thread;
+    // readActive_ (read_mutex_) tells disconnect() when the read chain has ended.
+    std::unique_ptr<boost::asio::io_context> ownContext_;
+    boost::asio::io_context& io_context_;
     boost::asio::serial_port serial_;
+    boost::asio::steady_timer read_timer_;
+    bool readActive_ = false;
+    std::mutex read_mutex_;
+    std::condition_variable read_cv_;
+    uint8_t rx_overflow_[256];
+    ReadProfile readProfile_ = ReadProfile::Batched;
     std::string port_;
     unsigned int baud_rate_;
     int timeoutPeriod_ms_;
 
-    std::vector<uint8_t> buffer_;
+    // Receive path: the read thread is the ring's only producer and never locks.
+    // buffer_mutex_ serializes the consumer side (receiveMessage() callers, the
+    // read thread in callback mode, flushIncomingSerial()).
+    std::unique_ptr<ByteRing> rx_ring_;
     std::mutex buffer_mutex_;
+    // Bytes parsed past (frames and junk) but not yet handed back to the read
+    // thread. parseFrame() only advances this; releaseRx() consumes it from the
+    // ring once per receive call.
+    size_t rxHeld_ = 0;
+    // Unread sub-messages of the last bundle parseFrame() took off the ring.
+    uint8_t rxBundle_[MAX_PAYLOAD];
+    size_t rxBundleLen_ = 0;
+    size_t rxBundlePos_ = 0;
+    // Arrival stamps. The read thread pushes one mark per read: the stream position
+    // of the read's first byte (the ring's written() count) and when the read came
+    // back. The parser (buffer_mutex_ held) pops marks as it passes them, so
+    // rxMark_ is the read that brought in the next frame's first byte; there is no
+    // peek, so the next mark waits in rxNextMark_. rxTiming_ is the timeline of the
+    // frame being parsed or dispatched, rxBundleTiming_ that of rxBundle_.
+    // A read brings in at least one byte, so the queue holds a mark per ring byte.
+    // If it still fills (noise parsed without a frame doesn't pop marks), the lost
+    // marks are noted in rxMarksLost_ and then in the next mark's lostBefore, and
+    // a frame that may have come from a lost read gets no arrival stamp.
+    struct ArrivalMark {
+        size_t position = 0;
+        std::chrono::steady_clock::time_point at{};
+        bool lostBefore = false;
+    };
+    std::unique_ptr<SPSCQueue<ArrivalMark>> rxMarks_;
+    std::atomic<bool> rxMarksLost_{false};
+    ArrivalMark rxMark_{};
+    ArrivalMark rxNextMark_{};
+    bool rxHasNextMark_ = false;
+    RxTiming rxTiming_;
+    RxTiming rxBundleTiming_;
     std::atomic<bool> running_;
     std::thread read_thread_;
 
-    // TX self-pacing. sendMessage() waits until earliest_next_send_ before
-    // dispatching, then advances earliest_next_send_ by the new frame's
-    // wire time. This caps the on-wire byte rate at the configured baud
-    // rate, so a sender can fire-and-forget back-to-back frames without
-    // overflowing a slow receiver's HW UART buffer (Arduino is 64 B).
-    // Mutex also serializes concurrent senders on a shared serial_port —
-    // boost::asio doesn't guarantee that on its own.
-    std::mutex send_mutex_;
-    std::chrono::steady_clock::time_point earliest_next_send_;
-    bool tx_pacing_enabled_;
-
-    // Position in buffer_ from which the parser should resume scanning for
-    // the sync byte pair. Advanced past false syncs without compacting; the
-    // buffer is only erased on valid frame extraction or when scan_pos_
-    // exceeds the compaction threshold. Drops resync from O(N²) to O(N).
-    size_t scan_pos_ = 0;
 
     // OmniSoc UART framing v3: see OmniSoc/Arduino_UART/SerialManager.h for
     // the canonical wire-format spec. Identical bytes on both sides.
@@ -90,20 +401,202 @@ private:
     static constexpr int CRC_SIZE = 2;
     static constexpr int FRAME_OVERHEAD = SYNC_SIZE + HEADER_SIZE + LEN_SIZE + CRC_SIZE;  // 6
     static constexpr int MAX_FRAME_SIZE = FRAME_OVERHEAD + MAX_PAYLOAD;                    // 54
+    static constexpr int PAYLOAD_OFFSET = SYNC_SIZE + HEADER_SIZE + LEN_SIZE;               // 4
+
+    // Default receive ring size: ~10 ms at 4 Mbaud, so the application can
+    // fall behind by a scheduler tick at high baud rates without losing bytes.
+    static constexpr size_t DEFAULT_RX_BUFFER = 4096;
+
+    // TX scheduler. Senders encode frames into their header's lane (MPSC, no
+    // allocation) or latest-value mailbox and return; the TX scheduler is the
+    // only writer on serial_. It picks frames most-urgent-first, packs them into
+    // txBatch_ and paces writes against the baud rate from one clock, so the
+    // on-wire byte rate never outruns a slow receiver's HW UART buffer
+    // (Arduino is 64 B).
+    // TxLane::frames/bytes count frames accepted but not yet packed (including
+    // one the scheduler put back in txCarry_ for the next write). popMutex makes
+    // the scheduler and DropOldest evictions (dropOldestTx()) share the queue's
+    // single consumer side.
+    struct TxFrame {
+        uint8_t size;
+        bool latest;
+        uint8_t bytes[MAX_FRAME_SIZE];
+    };
+    static constexpr size_t TX_QUEUE_CAPACITY = 256;
+    static constexpr size_t TX_BATCH_BYTES = 4096;
+    static constexpr int TX_LANES = 4;
+    struct TxLane {
+        MPSCQueue<TxFrame> queue{TX_QUEUE_CAPACITY};
+        std::atomic<size_t> frames{0};
+        std::atomic<size_t> bytes{0};
+        std::mutex popMutex;
+    };
+    TxLane txLanes_[TX_LANES];
+    TxFrame txCarry_[TX_LANES];
+    bool txCarryFull_[TX_LANES] = {};
+    TxPriority headerPriority_[256];
+    bool headerLatest_[256] = {};
+    uint8_t txBatch_[TX_BATCH_BYTES];
+
+    // Builds one write in txBatch_ (TX thread only). With bundling on, runs of
+    // small frames are merged into BUNDLE_HEADER frames as they are added.
+    class TxPacker {
+    public:
+        TxPacker(UART_Serial& owner, size_t budget);
+        bool add(const TxFrame& frame);   // false: doesn't fit this write
+        bool full() const;
+        size_t finish();                   // closes any open bundle; returns bytes
+    private:
+        size_t openWire() const;
+        void closeOpen();
+
+        UART_Serial& owner_;
+        size_t budget_;
+        size_t used_ = 0;
+        TxFrame open_;                     // first frame of the open bundle
+        size_t openCount_ = 0;
+        uint8_t bundle_[MAX_PAYLOAD];
+        size_t bundleLen_ = 0;
+    };
+
+    // Latest-value mailboxes, one per header, guarded by mailbox_mutex_.
+    // mailboxPerLane_/mailboxCount_ let the scheduler skip the scan when empty;
+    // mailboxLane_ is the lane a full mailbox was counted in.
+    std::mutex mailbox_mutex_;
+    TxFrame mailbox_[256];
+    bool mailboxFull_[256] = {};
+    uint8_t mailboxLane_[256] = {};
+    std::atomic<size_t> mailboxPerLane_[TX_LANES];
+    std::atomic<size_t> mailboxCount_{0};
+    uint8_t mailboxCursor_ = 0;
 
-    // Internal buffer cap (~4× max frame). On overflow in readFromSerial(),
-    // drop the oldest half and bump dropped_bytes_.
-    static constexpr size_t BUFFER_CAP = 256;
+    // One decision of the TX scheduler: write a batch from txBatch_, or wait for
+    // frames, the baud clock, a grant or the bundling window. On its own context
+    // a port runs them on tx_thread_ (txScheduler()); on a shared one there is no
+    // TX thread: pumpTx() runs them on tx_timer_'s strand, waits on tx_timer_ and
+    // writes with async_write, and wakeTx() posts kickTx() to end a wait early.
+    // txPumpActive_ and txKicks_ (tx_mutex_) tell disconnect() when it is done.
+    struct TxStep {
+        enum Kind { Write, Idle, Sleep, Credit, Bundle, Stop } kind = Stop;
+        size_t bytes = 0;                                  // Write
+        bool checkDriver = false;                          // Write: wait for driver room first
+        std::chrono::steady_clock::time_point until;       // Sleep
+        uint32_t grants = 0;                               // Credit
+        uint32_t adverts = 0;
+    };
+    std::chrono::steady_clock::time_point txWireFree_;
+    bool txWindowWaited_ = false;
+
+    std::thread tx_thread_;
+    boost::asio::steady_timer tx_timer_;
+    TxStep txParked_;
+    bool txPumpActive_ = false;
+    std::atomic<int> txKicks_{0};
+    std::atomic<bool> txKickPosted_{false};
+    std::mutex tx_mutex_;
+    std::condition_variable tx_cv_;          // scheduler waits for frames
+    std::condition_variable tx_space_cv_;    // Block senders and flushOutgoing() wait for drain
+    std::atomic<bool> txRunning_{false};
+    std::atomic<bool> txBusy_{false};
+    std::atomic<bool> txSchedulerWaiting_{false};
+    std::atomic<int> txSpaceWaiters_{0};
+    std::atomic<size_t> txDropped_{0};
+    std::atomic<size_t> txCoalesced_{0};
+    std::atomic<size_t> txBundled_{0};
+    bool txBundling_ = false;
+    int txBundleWindow_us_ = 500;
+    BackpressureOptions txBackpressure_;
+    size_t txBurstBytes_ = 64;
+    bool tx_pacing_enabled_;
+
+    // Credit flow control. The read thread stores the peer's latest grant in
+    // peerCredit_ as (received << 32 | received + free), one word so the pair
+    // never tears, and bumps creditGrants_; rxLost_ counts bytes the peer wrote
+    // that never arrived. txSentTotal_ belongs to the TX thread, which stamps it
+    // into our grants as they are packed. Our grants are built by
+    // advertiseCredit() on either thread under credit_mutex_.
+    static constexpr size_t CREDIT_SIZE = 10;
+    bool creditEnabled_ = false;
+    std::atomic<bool> creditActive_{false};
+    std::atomic<uint64_t> peerCredit_{0};
+    std::atomic<int64_t> peerCreditTime_ns_{0};
+    std::atomic<uint32_t> creditGrants_{0};
+    std::atomic<uint32_t> creditAdverts_{0};
+    std::atomic<size_t> creditStalls_{0};
+    std::atomic<uint32_t> rxLost_{0};
+    uint32_t txSentTotal_ = 0;
+    std::mutex credit_mutex_;
+    uint32_t advertisedEdge_ = 0;
+    std::chrono::steady_clock::time_point nextAdvert_;
+
+    // Sync-pair candidates from the last batched scan (SyncScan.h), as offsets
+    // from the ring head at scan time. syncShift_ counts bytes consumed since, so
+    // a candidate's current offset is syncCandidates_[i] - syncShift_. Entries
+    // [syncNext_, syncCount_) are still pending; the next scan resumes at
+    // syncScanEnd_. All guarded by buffer_mutex_.
+    static constexpr size_t SYNC_BATCH = 64;
+    size_t syncCandidates_[SYNC_BATCH];
+    size_t syncCount_ = 0;
+    size_t syncNext_ = 0;
+    size_t syncScanEnd_ = 0;
+    size_t syncShift_ = 0;
 
     std::atomic<bool> timeoutFlag{true};
     std::chrono::steady_clock::time_point lastTimeoutClock;
 
-    long byteSpacingTime_us = -1;
+    // One byte (10 bits) at the actual baud rate. In nanoseconds: at 3 Mbaud a byte
+    // is 3.33 us, and whole microseconds would pace 20% slow.
+    long byteSpacingTime_ns = -1;
+    unsigned int actualBaud_ = 0;
+    FlowControl flowControl_ = FlowControl::None;
+    size_t driverRxBytes_ = 0;
+    size_t driverTxBytes_ = 0;
 
     std::atomic<size_t> dropped_bytes_{0};
 
+    // Receive notification. rxSeen_ is the ring's written() count as of the last
+    // receiveMessage() that ran out of frames, so a waiter only wakes for data it
+    // hasn't looked at yet. rxWaiters_ lets the read thread skip the notify while
+    // nobody waits.
+    std::atomic<size_t> rxSeen_{0};
+    std::atomic<int> rxWaiters_{0};
+    std::mutex rx_wait_mutex_;
+    std::condition_variable rx_wait_cv_;
+
+    // Dispatch mode (onMessage() or onHeader() registered, fixed at connect()): the
+    // read thread is the only parser. It runs handlers under buffer_mutex_ and pushes
+    // frames without a handler onto rxFrames_, which receiveMessage() pops under
+    // rx_frames_mutex_ (the queue's single consumer side).
+    static constexpr size_t RX_FRAME_QUEUE = 256;
+    MessageCallback messageCallback_;
+    MessageCallback headerHandlers_[256];
+    bool queuedHeaders_[256] = {};
+    std::atomic<bool> dispatching_{false};
+    std::atomic<bool> headerDispatch_{false};
+    SPSCQueue<Frame> rxFrames_{RX_FRAME_QUEUE};
+    std::mutex rx_frames_mutex_;
+    std::atomic<size_t> dropped_frames_{0};
+
+    // Large messages. rxFragments_ is fed by whoever parses (buffer_mutex_ held).
+    // Finished messages go to largeCallback_, or wait in largeQueue_ for
+    // receiveLargeMessage(); buffers handed back by callers are kept in largeSpare_
+    // for the next message (both under large_mutex_).
+    struct LargeMessage {
+        uint8_t header;
+        std::vector<uint8_t> bytes;
+    };
+    FragmentReassembler rxFragments_{MAX_PAYLOAD};
+    LargeMessageCallback largeCallback_;
+    bool largeCompleted_ = false;
+    std::deque<LargeMessage> largeQueue_;
+    std::vector<std::vector<uint8_t>> largeSpare_;
+    std::mutex large_mutex_;
+    std::atomic<size_t> largeQueued_{0};
+    std::atomic<size_t> largeDropped_{0};
+    std::atomic<uint8_t> txMessageId_{0};
+
     // CRC-16/CCITT-FALSE — poly 0x1021, init 0xFFFF, no reflection, no xorout.
-    // crc16_ccitt("123456789", 9) == 0x29B1.
+    // crc16_ccitt("123456789", 9) == 0x29B1. Forwards to the shared CRC16.h engine.
     static uint16_t crc16_ccitt(const uint8_t* data, int len);
 };
 
@@ -0,0 +1,246 @@
+#include "CRC16.h"
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#  define OMNISOC_CRC_CLMUL 1
+#  include <immintrin.h>
+#  define OMNISOC_CLMUL_TARGET __attribute__((target("pclmul,ssse3")))
+#elif defined(_MSC_VER) && (defined(_M_X64) || defined(_M_IX86))
+#  define OMNISOC_CRC_CLMUL 1
+#  include <intrin.h>
+#  define OMNISOC_CLMUL_TARGET
+#endif
+
+namespace {
+
+const uint16_t POLY = 0x1021;
+
+// x^n mod P(x), P = x^16 + POLY. Folding constants for the CLMUL engine.
+uint32_t xPowModP(int n) {
+    uint32_t r = 1;
+    for (int i = 0; i < n; ++i) {
+        r <<= 1;
+        if (r & 0x10000) r ^= 0x10000 | POLY;
+    }
+    return r;
+}
+
+struct Crc16Tables {
+    // t[k][b]: contribution of byte b followed by k zero bytes.
+    uint16_t t[8][256];
+
+    Crc16Tables() {
+        for (int b = 0; b < 256; ++b) {
+            uint16_t crc = (uint16_t)(b << 8);
+            for (int j = 0; j < 8; ++j) {
+                crc = (crc & 0x8000) ? (uint16_t)((crc << 1) ^ POLY) : (uint16_t)(crc << 1);
+            }
+            t[0][b] = crc;
+        }
+        for (int k = 1; k < 8; ++k) {
+            for (int b = 0; b < 256; ++b) {
+                uint16_t prev = t[k - 1][b];
+                t[k][b] = (uint16_t)((prev << 8) ^ t[0][prev >> 8]);
+            }
+        }
+    }
+};
+
+const Crc16Tables& tables() {
+    static const Crc16Tables instance;
+    return instance;
+}
+
+uint16_t crcBitwise(const uint8_t* data, size_t len, uint16_t crc) {
+    for (size_t i = 0; i < len; ++i) {
+        crc ^= ((uint16_t)data[i]) << 8;
+        for (int j = 0; j < 8; ++j) {
+            if (crc & 0x8000) crc = (uint16_t)((crc << 1) ^ POLY);
+            else              crc = (uint16_t)(crc << 1);
+        }
+    }
+    return crc;
+}
+
+uint16_t crcTable(const uint8_t* data, size_t len, uint16_t crc) {
+    const uint16_t* t0 = tables().t[0];
+    for (size_t i = 0; i < len; ++i) {
+        crc = (uint16_t)((crc << 8) ^ t0[(crc >> 8) ^ data[i]]);
+    }
+    return crc;
+}
+
+uint16_t crcSlicing8(const uint8_t* data, size_t len, uint16_t crc) {
+    const Crc16Tables& tb = tables();
+    while (len >= 8) {
+        // The 16-bit register only overlaps the first two bytes of each block.
+        crc = (uint16_t)(tb.t[7][data[0] ^ (crc >> 8)] ^ tb.t[6][data[1] ^ (crc & 0xFF)] ^
+                         tb.t[5][data[2]] ^ tb.t[4][data[3]] ^ tb.t[3][data[4]] ^
+                         tb.t[2][data[5]] ^ tb.t[1][data[6]] ^ tb.t[0][data[7]]);
+        data += 8;
+        len -= 8;
+    }
+    for (size_t i = 0; i < len; ++i) {
+        crc = (uint16_t)((crc << 8) ^ tb.t[0][(crc >> 8) ^ data[i]]);
+    }
+    return crc;
+}
+
+#ifdef OMNISOC_CRC_CLMUL
+// Folds the input 16 bytes at a time. Blocks are byte-swapped so bit i of the
+// register is the coefficient of x^i (the CRC is not reflected). With X the
+// running remainder and N the next block, X*x^128 + N is congruent mod P to
+//   hi64(X)*(x^192 mod P) + lo64(X)*(x^128 mod P) + N,
+// which fits in 128 bits again. The register value `crc` enters by XOR into
+// the first two message bytes. What is left after the last block is congruent
+// to the whole prefix, so its CRC (init 0) over its 16 bytes is the prefix's CRC.
+OMNISOC_CLMUL_TARGET
+uint16_t crcClmul(const uint8_t* data, size_t len, uint16_t crc) {
+    if (len < 32) {
+        return crcSlicing8(data, len, crc);
+    }
+
+    static const uint64_t K1 = xPowModP(192);
+    static const uint64_t K2 = xPowModP(128);
+    const __m128i fold = _mm_set_epi64x((long long)K1, (long long)K2);
+    const __m128i bswap = _mm_set_epi8(0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12, 13, 14, 15);
+
+    __m128i x = _mm_shuffle_epi8(_mm_loadu_si128((const __m128i*)data), bswap);
+    x = _mm_xor_si128(x, _mm_set_epi64x((long long)((uint64_t)crc << 48), 0));
+    data += 16;
+    len -= 16;
+
+    while (len >= 16) {
+        __m128i next = _mm_shuffle_epi8(_mm_loadu_si128((const __m128i*)data), bswap);
+        __m128i hi = _mm_clmulepi64_si128(x, fold, 0x11);
+        __m128i lo = _mm_clmulepi64_si128(x, fold, 0x00);
+        x = _mm_xor_si128(_mm_xor_si128(hi, lo), next);
+        data += 16;
+        len -= 16;
+    }
+
+    uint8_t rest[16];
+    _mm_storeu_si128((__m128i*)rest, _mm_shuffle_epi8(x, bswap));
+    crc = crcSlicing8(rest, 16, 0);
+    return crcSlicing8(data, len, crc);
+}
+
+bool cpuHasClmul() {
+#  if defined(__GNUC__)
+    return __builtin_cpu_supports("pclmul") && __builtin_cpu_supports("ssse3");
+#  else
+    int info[4];
+    __cpuid(info, 1);
+    return (info[2] & (1 << 1)) && (info[2] & (1 << 9));  // PCLMULQDQ, SSSE3
+#  endif
+}
+#endif
+
+typedef uint16_t (*Crc16Fn)(const uint8_t*, size_t, uint16_t);
+
+struct Dispatch {
+    Crc16Engine engine;
+    Crc16Fn fn;
+
+    Dispatch() {
+        tables();
+#ifdef OMNISOC_CRC_CLMUL
+        if (cpuHasClmul()) {
+            engine = Crc16Engine::Clmul;
+            fn = crcClmul;
+            return;
+        }
+#endif
+        engine = Crc16Engine::Slicing8;
+        fn = crcSlicing8;
+    }
+};
+
+const Dispatch& dispatch() {
+    static const Dispatch instance;
+    return instance;
+}
+
+} // namespace
+
+uint16_t crc16_ccitt(const uint8_t* data, size_t len, uint16_t crc) {
+    return dispatch().fn(data, len, crc);
+}
+
+bool crc16_engine_supported(Crc16Engine engine) {
+    if (engine != Crc16Engine::Clmul) {
+        return true;
+    }
+#ifdef OMNISOC_CRC_CLMUL
+    return cpuHasClmul();
+#else
+    return false;
+#endif
+}
+
+Crc16Engine crc16_active_engine() {
+    return dispatch().engine;
+}
+
+const char* crc16_engine_name(Crc16Engine engine) {
+    switch (engine) {
+    case Crc16Engine::Bitwise:  return "bitwise";
+    case Crc16Engine::Table:    return "table";
+    case Crc16Engine::Slicing8: return "slicing-by-8";
+    case Crc16Engine::Clmul:    return "pclmulqdq";
+    }
+    return "unknown";
+}
+
+uint16_t crc16_ccitt_engine(Crc16Engine engine, const uint8_t* data, size_t len, uint16_t crc) {
+    switch (engine) {
+    case Crc16Engine::Bitwise:  return crcBitwise(data, len, crc);
+    case Crc16Engine::Table:    return crcTable(data, len, crc);
+    case Crc16Engine::Slicing8: return crcSlicing8(data, len, crc);
+    case Crc16Engine::Clmul:
+#ifdef OMNISOC_CRC_CLMUL
+        if (cpuHasClmul()) return crcClmul(data, len, crc);
+#endif
+        break;
+    }
+    return crc16_ccitt(data, len, crc);
+}
+
+bool crc16_self_test() {
+    static const uint8_t check[] = { '1', '2', '3', '4', '5', '6', '7', '8', '9' };
+
+    // Deterministic pseudo-random buffer (xorshift), with slack for misaligned starts.
+    uint8_t buf[1100];
+    uint32_t state = 0x12345678;
+    for (size_t i = 0; i < sizeof(buf); ++i) {
+        state ^= state << 13;
+        state ^= state >> 17;
+        state ^= state << 5;
+        buf[i] = (uint8_t)state;
+    }
+
+    const Crc16Engine engines[] = { Crc16Engine::Bitwise, Crc16Engine::Table, Crc16Engine::Slicing8, Crc16Engine::Clmul };
+    for (Crc16Engine engine : engines) {
+        if (!crc16_engine_supported(engine)) {
+            continue;
+        }
+        if (crc16_ccitt_engine(engine, check, sizeof(check)) != 0x29B1) {
+            return false;
+        }
+        for (size_t len = 0; len <= 1024; len += (len < 80 ? 1 : 37)) {
+            for (size_t offset = 0; offset < 4; ++offset) {
+                const uint8_t* p = buf + offset;
+                uint16_t expected = crcBitwise(p, len, 0xFFFF);
+                if (crc16_ccitt_engine(engine, p, len) != expected) {
+                    return false;
+                }
+                // Continuation across a split must match the one-shot value.
+                size_t split = len / 3;
+                uint16_t first = crc16_ccitt_engine(engine, p, split);
+                if (crc16_ccitt_engine(engine, p + split, len - split, first) != expected) {
+                    return false;
+                }
+            }
+        }
+    }
+    return crc16_ccitt(check, sizeof(check)) == 0x29B1;
+}
@@ -0,0 +1,48 @@
+#include <chrono>
+#include <cstdio>
+#include <vector>
+#include "CRC16.h"
+
+// Micro-benchmark for the CRC-16 engines. Sizes cover a UART v3 frame body
+// (hdr + len + up to 48 payload bytes) up to large Socket_Serial binary frames.
+
+int main()
+{
+    bool ok = crc16_self_test();
+    std::printf("self-test: %s\n", ok ? "pass" : "FAIL");
+    std::printf("active engine: %s\n\n", crc16_engine_name(crc16_active_engine()));
+    if (!ok) return 1;
+
+    const size_t sizes[] = { 2, 50, 256, 4096, 65536 };
+    const Crc16Engine engines[] = { Crc16Engine::Bitwise, Crc16Engine::Table, Crc16Engine::Slicing8, Crc16Engine::Clmul };
+
+    std::vector<uint8_t> data(65536);
+    for (size_t i = 0; i < data.size(); ++i) data[i] = (uint8_t)(i * 131 + 7);
+
+    std::printf("%-14s %8s %12s %12s\n", "engine", "bytes", "ns/call", "MB/s");
+    for (Crc16Engine engine : engines)
+    {
+        if (!crc16_engine_supported(engine))
+        {
+            std::printf("%-14s (not supported on this CPU)\n", crc16_engine_name(engine));
+            continue;
+        }
+        for (size_t size : sizes)
+        {
+            // ~64 MB per measurement, at least 1000 calls.
+            size_t iterations = (64u << 20) / size;
+            if (iterations < 1000) iterations = 1000;
+            if (engine == Crc16Engine::Bitwise) iterations /= 8;
+
+            volatile uint16_t sink = 0;
+            auto start = std::chrono::steady_clock::now();
+            for (size_t i = 0; i < iterations; ++i)
+                sink = sink ^ crc16_ccitt_engine(engine, data.data(), size);
+            double ns = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count();
+
+            std::printf("%-14s %8zu %12.1f %12.1f\n", crc16_engine_name(engine), size,
+                        ns / iterations, (double)size * iterations / ns * 1e3);
+        }
+    }
+    return 0;
+}
@@ -79,7 +79,7 @@ int main() {
 		}
 		else
 		{
-			std::this_thread::sleep_for(std::chrono::milliseconds(period_ms));//this is optional, but keeps this thread from being a busy thread
+			soc->waitForMessages(period_ms);//wakes as soon as a message arrives, otherwise keeps this thread from being a busy thread
 		}
 
 		std::string outMessage = "";
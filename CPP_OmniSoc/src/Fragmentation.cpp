@@ -0,0 +1,246 @@
+#include "Fragmentation.h"
+
+#include <cstring>
+
+size_t fragment_count(size_t len, size_t payloadSize) {
+    const size_t chunk = payloadSize - FRAGMENT_PREFIX;
+    return (len + FRAGMENT_LENGTH + chunk - 1) / chunk;
+}
+
+size_t fragment_max_message(size_t payloadSize) {
+    return FRAGMENT_MAX_COUNT * (payloadSize - FRAGMENT_PREFIX) - FRAGMENT_LENGTH;
+}
+
+size_t fragment_encode(uint8_t header, uint8_t msgId, size_t index,
+                       const uint8_t* message, size_t len, size_t payloadSize, uint8_t* out) {
+    const size_t chunk = payloadSize - FRAGMENT_PREFIX;
+    const size_t streamLen = FRAGMENT_LENGTH + len;
+    const size_t start = index * chunk;
+    const size_t n = streamLen - start < chunk ? streamLen - start : chunk;
+
+    out[0] = header;
+    out[1] = msgId;
+    out[2] = (uint8_t)(index & 0xFF);
+    out[3] = (uint8_t)((index >> 8) & 0xFF);
+    uint8_t* dst = out + FRAGMENT_PREFIX;
+    size_t pos = start;
+    for (; pos < FRAGMENT_LENGTH && pos < start + n; ++pos) {
+        *dst++ = (uint8_t)((len >> (8 * pos)) & 0xFF);
+    }
+    std::memcpy(dst, message + (pos - FRAGMENT_LENGTH), start + n - pos);
+    return FRAGMENT_PREFIX + n;
+}
+
+FragmentReassembler::FragmentReassembler(size_t payloadSize, size_t slots, size_t maxMessage, int timeout_ms)
+    : chunkSize_(payloadSize - FRAGMENT_PREFIX), maxMessage_(maxMessage), timeout_(timeout_ms), slots_(slots) {}
+
+void FragmentReassembler::setLimits(size_t slots, size_t maxMessage, int timeout_ms) {
+    slots_.assign(slots > 0 ? slots : 1, Slot());
+    maxMessage_ = maxMessage;
+    timeout_ = std::chrono::milliseconds(timeout_ms);
+}
+
+bool FragmentReassembler::streaming() const {
+    for (const ChunkHandler& handler : streamHandlers_) {
+        if (handler) {
+            return true;
+        }
+    }
+    return false;
+}
+
+void FragmentReassembler::add(const uint8_t* payload, size_t len, std::chrono::steady_clock::time_point now) {
+    expire(now);
+    if (len <= FRAGMENT_PREFIX || len - FRAGMENT_PREFIX > chunkSize_) {
+        return;
+    }
+    const uint8_t header = payload[0];
+    const uint8_t msgId = payload[1];
+    const size_t index = (size_t)payload[2] | ((size_t)payload[3] << 8);
+    Slot& slot = *slotFor(header, msgId, now);
+    slot.lastSeen = now;
+    if (slot.failed) {
+        return;
+    }
+
+    const uint8_t* chunk = payload + FRAGMENT_PREFIX;
+    const size_t n = len - FRAGMENT_PREFIX;
+    if (index == 0) {
+        if (n < FRAGMENT_LENGTH) {
+            drop(slot);
+            return;
+        }
+        slot.total = (size_t)chunk[0] | ((size_t)chunk[1] << 8) | ((size_t)chunk[2] << 16) | ((size_t)chunk[3] << 24);
+        slot.count = (slot.total + FRAGMENT_LENGTH + chunkSize_ - 1) / chunkSize_;
+        if (slot.count > FRAGMENT_MAX_COUNT || slot.have.size() > slot.count) {
+            drop(slot);
+            return;
+        }
+    }
+    if (slot.count > 0) {
+        // Every fragment but the last is full; the last holds the remainder.
+        const size_t expected = index + 1 < slot.count
+            ? chunkSize_
+            : slot.total + FRAGMENT_LENGTH - index * chunkSize_;
+        if (index >= slot.count || n != expected) {
+            drop(slot);
+            return;
+        }
+    } else if (n != chunkSize_) {
+        // Length unknown until fragment 0: a short fragment has to be the last one,
+        // so nothing past it may have arrived. The rest is checked against the count.
+        if (slot.have.size() > index + 1) {
+            drop(slot);
+            return;
+        }
+    }
+
+    if (streamHandlers_[header]) {
+        addStreamed(slot, index, chunk, n);
+    } else {
+        addBuffered(slot, index, chunk, n);
+    }
+}
+
+void FragmentReassembler::addBuffered(Slot& slot, size_t index, const uint8_t* chunk, size_t len) {
+    if (index < slot.have.size() && slot.have[index]) {
+        return;  // duplicate
+    }
+    if (index == 0 && slot.total > maxMessage_) {
+        drop(slot);
+        return;
+    }
+    size_t offset = 0;
+    if (index == 0) {
+        chunk += FRAGMENT_LENGTH;
+        len -= FRAGMENT_LENGTH;
+    } else {
+        offset = index * chunkSize_ - FRAGMENT_LENGTH;
+    }
+    if (offset + len > maxMessage_) {
+        drop(slot);
+        return;
+    }
+    if (slot.data.size() < offset + len) {
+        slot.data.resize(offset + len);
+    }
+    std::memcpy(slot.data.data() + offset, chunk, len);
+    if (slot.have.size() <= index) {
+        slot.have.resize(index + 1, 0);
+    }
+    slot.have[index] = 1;
+    slot.received++;
+
+    if (slot.count > 0 && slot.received == slot.count) {
+        slot.data.resize(slot.total);
+        if (messageHandler_) {
+            messageHandler_(slot.header, slot.data);
+        }
+        release(slot);
+    }
+}
+
+void FragmentReassembler::addStreamed(Slot& slot, size_t index, const uint8_t* chunk, size_t len) {
+    if (index != slot.nextIndex) {
+        drop(slot);
+        return;
+    }
+    Chunk out;
+    out.header = slot.header;
+    out.msgId = slot.msgId;
+    out.offset = index == 0 ? 0 : index * chunkSize_ - FRAGMENT_LENGTH;
+    out.bytes = index == 0 ? chunk + FRAGMENT_LENGTH : chunk;
+    out.len = index == 0 ? len - FRAGMENT_LENGTH : len;
+    out.total = slot.total;
+    out.complete = index + 1 == slot.count;
+    out.aborted = false;
+    slot.nextIndex++;
+    streamHandlers_[slot.header](out);
+    if (out.complete) {
+        release(slot);
+    }
+}
+
+FragmentReassembler::Slot* FragmentReassembler::slotFor(uint8_t header, uint8_t msgId,
+                                                        std::chrono::steady_clock::time_point now) {
+    Slot* victim = nullptr;
+    for (Slot& slot : slots_) {
+        if (slot.active && slot.header == header && slot.msgId == msgId) {
+            return &slot;
+        }
+        if (victim == nullptr || (victim->active && (!slot.active || slot.lastSeen < victim->lastSeen))) {
+            victim = &slot;
+        }
+    }
+    // Pool full: the least recently active message gives up its slot.
+    if (victim->active) {
+        if (!victim->failed) {
+            drop(*victim);
+        }
+        release(*victim);
+    }
+    victim->active = true;
+    victim->header = header;
+    victim->msgId = msgId;
+    victim->lastSeen = now;
+    return victim;
+}
+
+void FragmentReassembler::drop(Slot& slot) {
+    dropped_++;
+    if (streamHandlers_[slot.header] && slot.nextIndex > 0) {
+        Chunk out;
+        out.header = slot.header;
+        out.msgId = slot.msgId;
+        out.offset = 0;
+        out.bytes = nullptr;
+        out.len = 0;
+        out.total = slot.total;
+        out.complete = false;
+        out.aborted = true;
+        streamHandlers_[slot.header](out);
+    }
+    // Stays active (failed) so the rest of its fragments don't start a new message.
+    slot.failed = true;
+    slot.data.clear();
+    slot.have.clear();
+}
+
+void FragmentReassembler::release(Slot& slot) {
+    // clear() keeps the capacity: the buffer is reused by the next message.
+    slot.active = false;
+    slot.failed = false;
+    slot.total = SIZE_MAX;
+    slot.count = 0;
+    slot.received = 0;
+    slot.nextIndex = 0;
+    slot.have.clear();
+    slot.data.clear();
+}
+
+void FragmentReassembler::expire(std::chrono::steady_clock::time_point now) {
+    for (Slot& slot : slots_) {
+        if (slot.active && now - slot.lastSeen > timeout_) {
+            if (!slot.failed) {
+                drop(slot);
+            }
+            release(slot);
+        }
+    }
+}
+
+void FragmentReassembler::reset() {
+    for (Slot& slot : slots_) {
+        release(slot);
+    }
+}
+
+size_t FragmentReassembler::inProgress() const {
+    size_t count = 0;
+    for (const Slot& slot : slots_) {
+        if (slot.active && !slot.failed) {
+            ++count;
+        }
+    }
+    return count;
+}
@@ -0,0 +1,518 @@
+#include "ReliableChannel.h"
+#include "Socket_Serial.h"
+#include "UART_Serial.h"
+
+#include <algorithm>
+#include <cstring>
+#include <random>
+
+namespace {
+
+const uint8_t FLAG_DATA = 0x01;
+const uint8_t FLAG_ACK = 0x02;
+const uint8_t FLAG_BASE = 0x04;            // seq is the sender's oldest unacked frame
+const size_t ACK_SIZE = 8;                 // [flags][epoch][seq][ack][sack]
+const size_t SACK_BITS = 16;
+const int FAST_RETRANSMIT_SACKS = 3;
+const size_t SOCKET_MAX_MESSAGE = 4096;
+const size_t LINK_FRAME_OVERHEAD = 6;      // UART v3 framing around a payload
+
+void putU16(uint8_t* out, uint16_t v) {
+    out[0] = (uint8_t)(v & 0xFF);
+    out[1] = (uint8_t)((v >> 8) & 0xFF);
+}
+
+uint16_t getU16(const uint8_t* in) {
+    return (uint16_t)(in[0] | (in[1] << 8));
+}
+
+ReliableChannel::Options withLinkRate(ReliableChannel::Options options, size_t bytesPerSecond) {
+    if (options.linkBytesPerSecond == 0) {
+        options.linkBytesPerSecond = bytesPerSecond;
+    }
+    return options;
+}
+
+} // namespace
+
+ReliableChannel::ReliableChannel(SendFunction send, size_t maxPayload, const Options& options)
+    : send_(std::move(send)), maxData_(maxPayload - OVERHEAD), wireFrame_(maxPayload + LINK_FRAME_OVERHEAD),
+      options_(options), pending_(MAX_WINDOW), txFrame_(maxPayload), received_(MAX_WINDOW) {
+    start();
+}
+
+ReliableChannel::ReliableChannel(UART_Serial& uart, const Options& options)
+    : ReliableChannel([&uart](uint8_t header, const uint8_t* bytes, size_t len) {
+                          if (len > UART_Serial::MAX_PAYLOAD) {
+                              return -1;
+                          }
+                          return uart.sendMessage(header, bytes, (uint8_t)len);
+                      },
+                      UART_Serial::MAX_PAYLOAD, withLinkRate(options, uart.getBaudRate() / 10)) {
+    hook_ = std::make_shared<LinkHook>();
+    hook_->channel = this;
+    std::shared_ptr<LinkHook> hook = hook_;
+    uart.onHeader(HEADER, [hook](uint8_t header, const uint8_t* bytes, uint8_t len) {
+        std::lock_guard<std::mutex> lock(hook->mutex);
+        if (hook->channel) {
+            hook->channel->handleFrame(header, bytes, len);
+        }
+    });
+}
+
+ReliableChannel::ReliableChannel(Socket_Serial& socket, const Options& options)
+    : ReliableChannel([&socket](uint8_t header, const uint8_t* bytes, size_t len) {
+                          return socket.sendMessage(header, bytes, (uint32_t)len);
+                      },
+                      std::min<size_t>(socket.maxFramePayload, SOCKET_MAX_MESSAGE + OVERHEAD), options) {}
+
+ReliableChannel::~ReliableChannel() {
+    if (hook_) {
+        std::lock_guard<std::mutex> lock(hook_->mutex);
+        hook_->channel = nullptr;
+    }
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        running_ = false;
+        timer_cv_.notify_all();
+        space_cv_.notify_all();
+    }
+    if (timer_thread_.joinable()) {
+        timer_thread_.join();
+    }
+}
+
+void ReliableChannel::start() {
+    std::random_device rd;
+    epoch_ = (uint8_t)(rd() & 0xFF);
+    sndNext_ = (uint16_t)(rd() & 0xFFFF);
+    sndUna_ = sndNext_;
+    for (Pending& frame : pending_) {
+        frame.bytes.resize(maxData_);
+    }
+    for (Received& frame : received_) {
+        frame.bytes.resize(maxData_);
+    }
+    rto_ = std::chrono::milliseconds(options_.initialRto_ms);
+    updateWindow();
+    timer_thread_ = std::thread(&ReliableChannel::timerThread, this);
+}
+
+int ReliableChannel::sendMessage(uint8_t header, const uint8_t* bytes, size_t len) {
+    if (!reliable_[header]) {
+        return send_(header, bytes, len);
+    }
+    if (len > maxData_) {
+        return -1;
+    }
+
+    std::unique_lock<std::mutex> lock(mutex_);
+    auto room = [this]() { return !running_ || inFlight() < window_; };
+    if (!room()) {
+        if (options_.sendTimeout_ms == 0) {
+            return -2;
+        }
+        if (options_.sendTimeout_ms < 0) {
+            space_cv_.wait(lock, room);
+        } else if (!space_cv_.wait_for(lock, std::chrono::milliseconds(options_.sendTimeout_ms), room)) {
+            return -3;
+        }
+    }
+    if (!running_) {
+        return -3;
+    }
+
+    Pending& frame = pending_[sndNext_ % MAX_WINDOW];
+    frame.acked = false;
+    frame.retransmitted = false;
+    frame.seq = sndNext_++;
+    frame.header = header;
+    frame.len = len;
+    if (len > 0) {
+        std::memcpy(frame.bytes.data(), bytes, len);
+    }
+    stats_.sent++;
+    transmit(frame, std::chrono::steady_clock::now());
+    if (inFlight() == 1) {
+        timer_cv_.notify_one();   // the timer may be idle: a new RTO deadline
+    }
+    return 1;
+}
+
+void ReliableChannel::transmit(Pending& frame, std::chrono::steady_clock::time_point now) {
+    // A send the link rejects (queue full) is left to the RTO, like a loss.
+    uint8_t* out = txFrame_.data();
+    out[0] = (uint8_t)(FLAG_DATA | (peerEpoch_ >= 0 ? FLAG_ACK : 0) | (frame.seq == sndUna_ ? FLAG_BASE : 0));
+    out[1] = epoch_;
+    putU16(out + 2, frame.seq);
+    writeAck(out);
+    out[ACK_SIZE] = frame.header;
+    if (frame.len > 0) {
+        std::memcpy(out + OVERHEAD, frame.bytes.data(), frame.len);
+    }
+    frame.sentAt = now;
+    if (peerEpoch_ >= 0) {
+        ackPending_ = false;   // piggybacked
+    }
+    send_(HEADER, out, OVERHEAD + frame.len);
+}
+
+void ReliableChannel::sendAck(std::chrono::steady_clock::time_point now) {
+    (void)now;
+    if (peerEpoch_ < 0) {
+        return;
+    }
+    uint8_t out[ACK_SIZE];
+    out[0] = FLAG_ACK;
+    out[1] = epoch_;
+    putU16(out + 2, sndNext_);
+    writeAck(out);
+    ackPending_ = false;
+    stats_.acksSent++;
+    send_(HEADER, out, ACK_SIZE);
+}
+
+void ReliableChannel::writeAck(uint8_t* out) {
+    uint16_t sack = 0;
+    for (size_t i = 0; i < SACK_BITS; ++i) {
+        const uint16_t seq = (uint16_t)(rcvNext_ + 1 + i);
+        const Received& frame = received_[seq % MAX_WINDOW];
+        if (frame.have && frame.seq == seq) {
+            sack |= (uint16_t)(1u << i);
+        }
+    }
+    putU16(out + 4, rcvNext_);
+    putU16(out + 6, sack);
+}
+
+bool ReliableChannel::handleFrame(uint8_t header, const uint8_t* bytes, size_t len) {
+    if (header != HEADER) {
+        return false;
+    }
+    if (len < ACK_SIZE) {
+        return true;
+    }
+
+    // Frames ready for delivery stay in their received_ slots until the callbacks
+    // below have read them; receive_mutex_ keeps the next handleFrame() out of them.
+    std::lock_guard<std::mutex> receiveLock(receive_mutex_);
+    const auto now = std::chrono::steady_clock::now();
+    const uint8_t flags = bytes[0];
+    size_t ready = 0;
+    uint16_t first = 0;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (flags & FLAG_ACK) {
+            processAck(getU16(bytes + 4), getU16(bytes + 6), now);
+        }
+        if ((flags & FLAG_DATA) && len >= OVERHEAD) {
+            const uint16_t seq = getU16(bytes + 2);
+            const int epoch = bytes[1];
+            // A base frame ahead of rcvNext_, or further behind than any window,
+            // comes from a restart that drew the same epoch.
+            const int16_t ahead = (int16_t)(uint16_t)(seq - rcvNext_);
+            const bool renumbered = ahead > 0 || ahead < -(int)MAX_WINDOW;
+            if ((flags & FLAG_BASE) && (epoch != peerEpoch_ || renumbered)) {
+                // First frame from the peer, or it restarted: adopt its numbering at
+                // its oldest unacked frame. Everything before that was acked (to an
+                // earlier incarnation of this channel, if any).
+                peerEpoch_ = epoch;
+                rcvNext_ = seq;
+                for (Received& frame : received_) {
+                    frame.have = false;
+                }
+            }
+            if (epoch == peerEpoch_) {
+                first = rcvNext_;
+                ready = processData(seq, bytes[ACK_SIZE], bytes + OVERHEAD, len - OVERHEAD, now);
+            }
+        }
+    }
+    for (size_t i = 0; i < ready; ++i) {
+        deliver(received_[(uint16_t)(first + i) % MAX_WINDOW]);
+    }
+    return true;
+}
+
+void ReliableChannel::processAck(uint16_t ack, uint16_t sack, std::chrono::steady_clock::time_point now) {
+    const uint16_t advanced = (uint16_t)(ack - sndUna_);
+    if (advanced > inFlight()) {
+        return;   // stale, or not about our frames
+    }
+
+    // One RTT sample per ack: the frame that triggered it is the most recently sent
+    // of those it covers for the first time; the others may have sat at the peer
+    // behind a hole, or past the sack bits, for a while. If any of them was resent,
+    // the trigger may have been a retransmission and there is no sample (Karn).
+    bool ambiguous = false;
+    auto rtt = std::chrono::steady_clock::duration::max();
+    auto covers = [&](Pending& frame) {
+        frame.acked = true;
+        ambiguous = ambiguous || frame.retransmitted;
+        rtt = std::min<std::chrono::steady_clock::duration>(rtt, now - frame.sentAt);
+    };
+    for (uint16_t seq = sndUna_; seq != ack; ++seq) {
+        Pending& frame = pending_[seq % MAX_WINDOW];
+        if (!frame.acked) {
+            covers(frame);
+        }
+    }
+    sndUna_ = ack;
+
+    bool sacked = false;
+    for (size_t i = 0; i < SACK_BITS; ++i) {
+        const uint16_t seq = (uint16_t)(ack + 1 + i);
+        if (!(sack & (1u << i)) || (uint16_t)(seq - sndUna_) >= inFlight()) {
+            continue;
+        }
+        Pending& frame = pending_[seq % MAX_WINDOW];
+        if (!frame.acked) {
+            covers(frame);
+            sacked = true;
+        }
+    }
+    const bool haveSample = !ambiguous && rtt != std::chrono::steady_clock::duration::max();
+    if (haveSample) {
+        sampleRtt(rtt);
+    } else if (advanced > 0 && haveRtt_) {
+        // The path works again: drop the timeout backoff even without a clean sample,
+        // or a lossy link that only ever acks retransmissions stays at maxRto_ms.
+        resetRto();
+    }
+
+    // Selective retransmit: a hole with FAST_RETRANSMIT_SACKS later frames acked is
+    // lost, not late. Resent at most once per smoothed RTT.
+    if (sack != 0) {
+        const auto spacing = haveRtt_ ? srtt_ : rto_;
+        int later = 0;
+        for (size_t i = 0; i < SACK_BITS; ++i) {
+            later += (sack >> i) & 1;
+        }
+        for (size_t j = 0; j <= SACK_BITS && later >= FAST_RETRANSMIT_SACKS; ++j) {
+            const uint16_t seq = (uint16_t)(ack + j);
+            if (j > 0 && (sack & (1u << (j - 1)))) {
+                later--;   // seq itself was acked; fewer acked frames lie past the next hole
+                continue;
+            }
+            if ((uint16_t)(seq - sndUna_) >= inFlight()) {
+                break;
+            }
+            Pending& frame = pending_[seq % MAX_WINDOW];
+            if (!frame.acked && now - frame.sentAt >= spacing) {
+                frame.retransmitted = true;
+                stats_.retransmitted++;
+                stats_.fastRetransmits++;
+                transmit(frame, now);
+            }
+        }
+    }
+
+    if (advanced > 0 || sacked) {
+        space_cv_.notify_all();
+    }
+}
+
+size_t ReliableChannel::processData(uint16_t seq, uint8_t header, const uint8_t* bytes, size_t len,
+                                    std::chrono::steady_clock::time_point now) {
+    const int16_t ahead = (int16_t)(uint16_t)(seq - rcvNext_);
+    if (ahead < 0) {
+        // Delivered already: our ack was lost. Say so again right away.
+        stats_.duplicates++;
+        sendAck(now);
+        return 0;
+    }
+    if ((size_t)ahead >= MAX_WINDOW || len > maxData_) {
+        sendAck(now);
+        return 0;
+    }
+    Received& slot = received_[seq % MAX_WINDOW];
+    if (slot.have && slot.seq == seq) {
+        stats_.duplicates++;
+        sendAck(now);
+        return 0;
+    }
+    slot.have = true;
+    slot.seq = seq;
+    slot.header = header;
+    slot.len = len;
+    if (len > 0) {
+        std::memcpy(slot.bytes.data(), bytes, len);
+    }
+    if (ahead > 0) {
+        // A gap: ack now so the sacks reach the sender while the hole is fresh.
+        stats_.outOfOrder++;
+        sendAck(now);
+        return 0;
+    }
+
+    size_t count = 0;
+    while (true) {
+        Received& frame = received_[rcvNext_ % MAX_WINDOW];
+        if (!frame.have || frame.seq != rcvNext_) {
+            break;
+        }
+        frame.have = false;
+        rcvNext_++;
+        count++;
+    }
+    stats_.delivered += count;
+
+    // Delayed ack, but never for more than two frames or across a gap just filled.
+    if (options_.ackDelay_ms <= 0 || count > 1 || ackPending_) {
+        sendAck(now);
+    } else {
+        ackPending_ = true;
+        ackDeadline_ = now + std::chrono::milliseconds(options_.ackDelay_ms);
+        timer_cv_.notify_one();
+    }
+    return count;
+}
+
+void ReliableChannel::sampleRtt(std::chrono::steady_clock::duration rtt) {
+    // Jacobson/Karels: srtt += (rtt - srtt) / 8, rttvar += (|rtt - srtt| - rttvar) / 4.
+    if (!haveRtt_) {
+        srtt_ = rtt;
+        rttvar_ = rtt / 2;
+        rttMin_ = rtt;
+        haveRtt_ = true;
+    } else {
+        const auto err = rtt > srtt_ ? rtt - srtt_ : srtt_ - rtt;
+        rttvar_ = (rttvar_ * 3 + err) / 4;
+        srtt_ = (srtt_ * 7 + rtt) / 8;
+        rttMin_ = std::min(rttMin_, rtt);
+    }
+    resetRto();
+    updateWindow();
+}
+
+void ReliableChannel::resetRto() {
+    const auto variance = std::max<std::chrono::steady_clock::duration>(rttvar_ * 4, std::chrono::milliseconds(1));
+    rto_ = std::min<std::chrono::steady_clock::duration>(
+        std::max<std::chrono::steady_clock::duration>(srtt_ + variance, std::chrono::milliseconds(options_.minRto_ms)),
+        std::chrono::milliseconds(options_.maxRto_ms));
+}
+
+void ReliableChannel::updateWindow() {
+    if (options_.window > 0) {
+        window_ = std::min<size_t>(options_.window, (size_t)MAX_WINDOW);
+        return;
+    }
+    if (options_.linkBytesPerSecond == 0) {
+        window_ = 64;
+        return;
+    }
+    if (!haveRtt_) {
+        window_ = 4;   // until the first RTT sample
+        return;
+    }
+    // Bandwidth-delay product in full-size frames, with the minimum RTT so queueing
+    // in the link doesn't inflate the window that causes it. Two frames of slack
+    // keep the pipe busy while an ack is on its way.
+    const double rtt_s = std::chrono::duration<double>(rttMin_).count();
+    const size_t bdp = (size_t)(options_.linkBytesPerSecond * rtt_s / wireFrame_) + 1;
+    window_ = std::min<size_t>(std::max<size_t>(bdp + 2, 4), (size_t)MAX_WINDOW);
+}
+
+void ReliableChannel::deliver(const Received& frame) {
+    if (messageCallback_) {
+        messageCallback_(frame.header, frame.bytes.data(), frame.len);
+        return;
+    }
+    std::lock_guard<std::mutex> lock(queue_mutex_);
+    if (queue_.size() >= RX_QUEUE_DEPTH) {
+        droppedIncoming_++;
+        return;
+    }
+    queue_.emplace_back();
+    Delivery& message = queue_.back();
+    message.header = frame.header;
+    if (!spare_.empty()) {
+        message.bytes.swap(spare_.back());
+        spare_.pop_back();
+    }
+    message.bytes.assign(frame.bytes.begin(), frame.bytes.begin() + frame.len);
+}
+
+int ReliableChannel::receiveMessage(uint8_t& header, std::vector<uint8_t>& bytes) {
+    std::lock_guard<std::mutex> lock(queue_mutex_);
+    if (queue_.empty()) {
+        return -1;
+    }
+    Delivery& message = queue_.front();
+    header = message.header;
+    bytes.swap(message.bytes);
+    if (spare_.size() < RX_QUEUE_DEPTH) {
+        spare_.push_back(std::move(message.bytes));
+    }
+    queue_.pop_front();
+    return 1;
+}
+
+bool ReliableChannel::flush(int timeout_ms) {
+    std::unique_lock<std::mutex> lock(mutex_);
+    auto idle = [this]() { return !running_ || inFlight() == 0; };
+    if (timeout_ms < 0) {
+        space_cv_.wait(lock, idle);
+    } else {
+        space_cv_.wait_for(lock, std::chrono::milliseconds(timeout_ms), idle);
+    }
+    return inFlight() == 0;
+}
+
+ReliableChannel::Stats ReliableChannel::getStats() {
+    Stats stats;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        stats = stats_;
+        stats.inFlight = inFlight();
+        stats.window = window_;
+        stats.srtt_ms = haveRtt_ ? std::chrono::duration<double, std::milli>(srtt_).count() : -1;
+        stats.rto_ms = std::chrono::duration<double, std::milli>(rto_).count();
+    }
+    std::lock_guard<std::mutex> lock(queue_mutex_);
+    stats.droppedIncoming = droppedIncoming_;
+    return stats;
+}
+
+void ReliableChannel::timerThread() {
+    // Sends delayed acks and retransmits frames whose RTO ran out. Each expiry
+    // doubles the RTO (up to maxRto_ms) until a fresh RTT sample resets it. Only
+    // frames the peer's sack can report on are timed: past that, an unacked frame
+    // may simply be waiting behind a hole, and it gets its turn as sndUna_ moves.
+    std::unique_lock<std::mutex> lock(mutex_);
+    while (running_) {
+        const auto now = std::chrono::steady_clock::now();
+        if (ackPending_ && now >= ackDeadline_) {
+            sendAck(now);
+        }
+
+        auto next = std::chrono::steady_clock::time_point::max();
+        if (ackPending_) {
+            next = ackDeadline_;
+        }
+        bool expired = false;
+        for (uint16_t seq = sndUna_; seq != sndNext_ && (uint16_t)(seq - sndUna_) <= SACK_BITS; ++seq) {
+            Pending& frame = pending_[seq % MAX_WINDOW];
+            if (frame.acked) {
+                continue;
+            }
+            if (frame.sentAt + rto_ <= now) {
+                frame.retransmitted = true;
+                stats_.retransmitted++;
+                transmit(frame, now);
+                expired = true;
+            }
+            next = std::min(next, frame.sentAt + rto_);
+        }
+        if (expired) {
+            stats_.timeouts++;
+            rto_ = std::min<std::chrono::steady_clock::duration>(rto_ * 2, std::chrono::milliseconds(options_.maxRto_ms));
+        }
+
+        if (next == std::chrono::steady_clock::time_point::max()) {
+            timer_cv_.wait(lock);
+        } else {
+            timer_cv_.wait_until(lock, next);
+        }
+    }
+}
@@ -0,0 +1,34 @@
+#include "SerialBaud.h"
+
+#if defined(__linux__)
+// The kernel's termios2 lives in <asm/termbits.h>, which clashes with glibc's
+// <termios.h>; this file includes the kernel headers only.
+#  include <asm/ioctls.h>
+#  include <asm/termbits.h>
+extern "C" int ioctl(int fd, unsigned long request, ...);
+#endif
+
+bool serial_set_custom_baud(int fd, unsigned int baud, unsigned int* actualBaud) {
+#if defined(__linux__)
+    struct termios2 tio;
+    if (baud == 0 || ioctl(fd, TCGETS2, &tio) != 0) {
+        return false;
+    }
+    tio.c_cflag &= ~(tcflag_t)(CBAUD | (CBAUD << IBSHIFT));
+    tio.c_cflag |= BOTHER | (BOTHER << IBSHIFT);
+    tio.c_ispeed = baud;
+    tio.c_ospeed = baud;
+    if (ioctl(fd, TCSETS2, &tio) != 0) {
+        return false;
+    }
+    if (actualBaud != nullptr) {
+        *actualBaud = ioctl(fd, TCGETS2, &tio) == 0 ? tio.c_ospeed : baud;
+    }
+    return true;
+#else
+    (void)fd;
+    (void)baud;
+    (void)actualBaud;
+    return false;
+#endif
+}
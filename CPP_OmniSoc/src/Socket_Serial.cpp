@@ -1,10 +1,54 @@
 #include "Socket_Serial.h"
 
+#include <algorithm>
 #include <chrono>
+#include <cmath>
+#include <cstring>
 #include <iostream>
 
+#if defined(__unix__) || defined(__APPLE__)
+#  include <cerrno>
+#  include <climits>
+#  include <ctime>
+#  include <poll.h>
+#  include <sys/socket.h>
+#  include <sys/uio.h>
+#endif
+
+namespace {
+// Adapts a slice of a const_buffer vector to asio's ConstBufferSequence.
+struct ConstBufferRange {
+    typedef boost::asio::const_buffer value_type;
+    typedef std::vector<boost::asio::const_buffer>::const_iterator const_iterator;
+    const_iterator first;
+    const_iterator last;
+    const_iterator begin() const { return first; }
+    const_iterator end() const { return last; }
+};
+
+std::chrono::steady_clock::duration toDuration(int64_t ticks) {
+    return std::chrono::steady_clock::duration(ticks);
+}
+
+double ticksToMs(int64_t ticks) {
+    return std::chrono::duration<double, std::milli>(toDuration(ticks)).count();
+}
+
+int64_t msToTicks(int ms) {
+    return std::chrono::duration_cast<std::chrono::steady_clock::duration>(std::chrono::milliseconds(ms)).count();
+}
+
+void putU32(std::string& out, uint32_t v) {
+    for (int i = 0; i < 4; i++) { out.push_back(static_cast<char>((v >> (8 * i)) & 0xFF)); }
+}
+}
+
 Socket_Serial::Socket_Serial(const std::string& _IP_Address, const std::string& _port, bool _isServer, bool _asyncronousFlag)
-    : io_context_(), socket_(io_context_) {
+    : io_context_(), socket_(io_context_),
+      incoming_buffer_(new SPSCQueue<IncomingMessage>(16384)),
+      incoming_frames_(new SPSCQueue<BinaryMessage>(16384)),
+      outgoing_buffer_(new MPSCQueue<std::string>(16384)),
+      heartbeat_timer_(io_context_), cork_timer_(io_context_) {
     
     asyncronousFlag = _asyncronousFlag;
     IP_Address = _IP_Address;
@@ -33,30 +77,36 @@ void Socket_Serial::connect(bool blocking_flag, bool auto_reconnect, int _period
 
     if (blocking_flag)
     {
-        while (!connectedFlag)
-        {
-            std::this_thread::sleep_for(std::chrono::milliseconds(50));
-        }
+        std::unique_lock<std::mutex> lock(state_mutex_);
+        state_cv_.wait(lock, [this]() { return connectedFlag || killFlag; });
     }
 }
 
 void Socket_Serial::disconnect() {
-    try
-    {
-        if (acceptor_ != nullptr && acceptor_->is_open())
-        { acceptor_->close(); }
-    }
-    catch(...){}
-
     try
     {
         std::cout << "Connection Closed" << std::endl;
         autoReconnect = false;
         killFlag = true;
+        notifyState();
+        // Cancels a connect/accept in flight on the connection thread right away.
+        io_context_.stop();
+        {
+            std::lock_guard<std::mutex> lock(rx_wait_mutex_);
+            rx_wait_cv_.notify_all();
+        }
+        {
+            std::lock_guard<std::mutex> lock(backpressure_mutex_);
+            tx_space_cv_.notify_all();
+        }
 
         if (connection_thread_.joinable())
         { connection_thread_.join(); }
 
+        // The connection thread is gone, so nothing can start a new io thread.
+        // Stopping the io_context releases an event-driven serial thread.
+        io_context_.stop();
+
         if (serial_thread_.joinable())
         { serial_thread_.join(); }
 
@@ -70,40 +120,338 @@ void Socket_Serial::disconnect() {
     }
 }
 
-void Socket_Serial::send(const std::string& msg) {
+int Socket_Serial::send(const std::string& msg) {
+    if (framing != Framing::Delimited) {
+        if (!suppressCatchPrints) { std::cerr << "send(string) needs Delimited framing; use sendMessage()" << std::endl; }
+        return -1;
+    }
+
+    // Copy into a pooled slot; never waits on the writer.
+    return enqueueOutgoing(msg.size() + msgDelimiter.size(), [&msg](std::string& slot) { slot = msg; });
+}
+
+template <typename Fill>
+int Socket_Serial::enqueueOutgoing(size_t bytes, Fill&& fill) {
+    while (true) {
+        // Fast path, lock-free: below both high-water marks. A message that exceeds the
+        // byte limit on its own is still accepted into an empty queue.
+        if (!backpressured_ && outgoing_buffer_->size() < highWaterMessages_ &&
+            (outgoingBytes_ + bytes <= highWaterBytes_ || outgoingBytes_ == 0)) {
+            // Bytes are counted before the push so the writer can never subtract them first.
+            noteQueued(bytes);
+            if (outgoing_buffer_->emplace(fill)) {
+                postFlush();
+                return 1;
+            }
+            outgoingBytes_ -= bytes;
+        }
+
+        int rc = makeRoom();
+        if (rc != 1) { return rc; }
+    }
+}
+
+int Socket_Serial::makeRoom() {
+    std::unique_lock<std::mutex> lock(backpressure_mutex_);
+
+    // Pairs with releaseBackpressure(): either the writer sees backpressured_ and
+    // clears it, or drained() here sees what the writer already took off the queue.
+    const size_t capacity = outgoing_buffer_->capacity();
+    auto drained = [&]() {
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        if (backpressure_.drained(outgoingBytes_, outgoing_buffer_->size(), capacity)) { backpressured_ = false; }
+        return !backpressured_;
+    };
+
+    switch (backpressure_.policy) {
+    case BackpressureOptions::Policy::DropOldest:
+        lock.unlock();
+        if (dropOldest()) { return 1; }
+        droppedOutgoing_++; // nothing left to drop; the new message cannot fit
+        return -2;
+
+    case BackpressureOptions::Policy::Fail:
+        backpressured_ = true;
+        return drained() ? 1 : -2;
+
+    case BackpressureOptions::Policy::Block: {
+        backpressured_ = true;
+        txWaiters_++;
+        auto ready = [&]() { return drained() || killFlag; };
+        if (backpressure_.blockTimeout_ms < 0) { tx_space_cv_.wait(lock, ready); }
+        else { tx_space_cv_.wait_for(lock, std::chrono::milliseconds(backpressure_.blockTimeout_ms), ready); }
+        txWaiters_--;
+        return (killFlag || backpressured_) ? -3 : 1;
+    }
+
+    case BackpressureOptions::Policy::DropNewest:
+    default:
+        backpressured_ = true;
+        if (drained()) { return 1; }
+        droppedOutgoing_++;
+        return -2;
+    }
+}
+
+bool Socket_Serial::dropOldest() {
     std::lock_guard<std::mutex> lock(out_buffer_mutex_);
-    outgoing_buffer_.push_back(msg);
+    std::string msg;
+    if (!outgoing_buffer_->pop(msg)) { return false; }
+
+    outgoingBytes_ -= msg.size() + (framing == Framing::Delimited ? msgDelimiter.size() : 0);
+    droppedOutgoing_++;
+    return true;
+}
+
+void Socket_Serial::releaseBackpressure() {
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    if (!backpressured_) { return; }
+
+    std::lock_guard<std::mutex> lock(backpressure_mutex_);
+    if (!backpressure_.drained(outgoingBytes_, outgoing_buffer_->size(), outgoing_buffer_->capacity())) { return; }
+    backpressured_ = false;
+    if (txWaiters_ > 0) { tx_space_cv_.notify_all(); }
+}
+
+void Socket_Serial::setBackpressure(const BackpressureOptions& options) {
+    {
+        std::lock_guard<std::mutex> lock(backpressure_mutex_);
+        backpressure_ = options;
+        highWaterBytes_ = options.highBytes();
+        highWaterMessages_ = options.highMessages(outgoing_buffer_->capacity());
+    }
+    releaseBackpressure();
+}
+
+BackpressureOptions Socket_Serial::getBackpressure() {
+    std::lock_guard<std::mutex> lock(backpressure_mutex_);
+    return backpressure_;
+}
+
+void Socket_Serial::noteQueued(size_t bytes) {
+    // First message into an empty queue starts the cork window.
+    if (outgoingBytes_.fetch_add(bytes) == 0) {
+        firstQueuedTime_ = std::chrono::steady_clock::now().time_since_epoch().count();
+    }
+}
+
+void Socket_Serial::postFlush() {
+    // Event-driven: kick the io thread right away instead of waiting for a tick.
+    // One pending flush picks up everything queued before it runs.
+    if (eventDriven && connectedFlag && !flushPosted_.exchange(true)) {
+        boost::asio::post(io_context_, [this]() {
+            flushPosted_ = false;
+            startWrite();
+        });
+    }
+}
+
+int Socket_Serial::sendMessage(uint8_t header, const uint8_t* bytes, uint32_t len) {
+    if (framing == Framing::Delimited || header == LINK_CONTROL_HEADER || len > maxFramePayload) {
+        return -1;
+    }
+
+    // Encode straight into a pooled queue slot: one copy of the payload, no delimiter.
+    const bool withCrc = framing == Framing::LengthPrefixedCRC;
+    const size_t frameBytes = (withCrc ? FrameParser::CRC_OVERHEAD : FrameParser::PLAIN_OVERHEAD) + len;
+    return enqueueOutgoing(frameBytes, [&](std::string& slot) {
+        slot.clear();
+        FrameParser::encode(slot, withCrc, header, bytes, len);
+    });
+}
+
+int Socket_Serial::sendMessage(uint8_t header, const float* data, uint32_t numFloats) {
+    if (numFloats > maxFramePayload / 4) {
+        return -1;
+    }
+    // Wire format is identical to the bytes version; floats are copied as-is (little-endian hosts).
+    return sendMessage(header, reinterpret_cast<const uint8_t*>(data), numFloats * 4);
+}
+
+int Socket_Serial::popFrame(BinaryMessage& frame) {
+    std::lock_guard<std::mutex> lock(in_buffer_mutex_);
+    return incoming_frames_->pop(frame) ? 1 : -1;
+}
+
+int Socket_Serial::receiveMessage(uint8_t& header, uint8_t* bytes, uint32_t& len, uint32_t maxLen) {
+    BinaryMessage frame;
+    int rc = popFrame(frame);
+    if (rc != 1) { return rc; }
+
+    if (frame.bytes.size() > maxLen) {
+        len = 0;
+        return -5;
+    }
+    header = frame.header;
+    len = static_cast<uint32_t>(frame.bytes.size());
+    if (len > 0) {
+        std::memcpy(bytes, frame.bytes.data(), len);
+    }
+    return 1;
+}
+
+int Socket_Serial::receiveMessage(uint8_t& header, std::vector<uint8_t>& bytes) {
+    BinaryMessage frame;
+    int rc = popFrame(frame);
+    if (rc != 1) { return rc; }
+
+    header = frame.header;
+    bytes = std::move(frame.bytes);
+    return 1;
+}
+
+int Socket_Serial::receiveMessage(BinaryMessage& message) {
+    int rc = popFrame(message);
+    if (rc != 1) { return rc; }
+
+    message.timing.dispatched = std::chrono::steady_clock::now();
+    return 1;
+}
+
+int Socket_Serial::receiveMessage(uint8_t& header, uint8_t* bytes, uint8_t& len) {
+    uint32_t wideLen = 0;
+    int rc = receiveMessage(header, bytes, wideLen, COMPAT_MAX_PAYLOAD);
+    len = static_cast<uint8_t>(wideLen);
+    return rc;
+}
+
+int Socket_Serial::receiveMessage(uint8_t& header, float* data, uint8_t& numFloats) {
+    uint8_t buf[COMPAT_MAX_PAYLOAD];
+    uint8_t len = 0;
+    int rc = receiveMessage(header, buf, len);
+    if (rc != 1) {
+        numFloats = 0;
+        return rc;
+    }
+    if (len % 4 != 0) {
+        numFloats = 0;
+        return -6;
+    }
+    numFloats = len / 4;
+    if (numFloats > 0) {
+        std::memcpy(data, buf, len);
+    }
+    return 1;
 }
 
 std::vector<std::string> Socket_Serial::receive(int count) {
     std::vector<std::string> messages;
-    std::unique_lock<std::mutex> lock(in_buffer_mutex_);
+    std::lock_guard<std::mutex> lock(in_buffer_mutex_);
 
-    if (count == -1) {
-        messages = std::move(incoming_buffer_);
-        incoming_buffer_.clear();
-    }
-    else {
-        int num_messages = std::min(count, static_cast<int>(incoming_buffer_.size()));
-        messages.insert(messages.end(), incoming_buffer_.begin(), incoming_buffer_.begin() + num_messages);
-        incoming_buffer_.erase(incoming_buffer_.begin(), incoming_buffer_.begin() + num_messages);
+    // O(count): pops from the front of the ring, nothing shifts.
+    IncomingMessage msg;
+    while ((count < 0 || static_cast<int>(messages.size()) < count) && incoming_buffer_->pop(msg)) {
+        messages.push_back(std::move(msg.text));
     }
 
     return messages;
 }
 
+size_t Socket_Serial::receive(std::vector<std::string>& out, int count) {
+    std::lock_guard<std::mutex> lock(in_buffer_mutex_);
+
+    // The caller's string rides into the queue slot through `msg` and the slot's comes back.
+    IncomingMessage msg;
+    size_t n = 0;
+    while (count < 0 || static_cast<int>(n) < count) {
+        if (n == out.size()) { out.emplace_back(); }
+        msg.text.swap(out[n]);
+        bool popped = incoming_buffer_->pop(msg);
+        msg.text.swap(out[n]);
+        if (!popped) { break; }
+        ++n;
+    }
+    out.resize(n);
+    return n;
+}
+
+size_t Socket_Serial::receive(std::vector<std::string>& out, std::vector<RxTiming>& timing, int count) {
+    std::lock_guard<std::mutex> lock(in_buffer_mutex_);
+
+    IncomingMessage msg;
+    size_t n = 0;
+    while (count < 0 || static_cast<int>(n) < count) {
+        if (n == out.size()) { out.emplace_back(); }
+        msg.text.swap(out[n]);
+        bool popped = incoming_buffer_->pop(msg);
+        msg.text.swap(out[n]);
+        if (!popped) { break; }
+        if (n == timing.size()) { timing.emplace_back(); }
+        timing[n] = msg.timing;
+        ++n;
+    }
+    out.resize(n);
+    timing.resize(n);
+    if (n > 0) {
+        const auto now = std::chrono::steady_clock::now();
+        for (size_t i = 0; i < n; ++i) { timing[i].dispatched = now; }
+    }
+    return n;
+}
+
 bool Socket_Serial::isConnected() {
     return connectedFlag;
 }
 
 void Socket_Serial::clearInBuffer() {
     std::lock_guard<std::mutex> lock(in_buffer_mutex_);
-    incoming_buffer_.clear();
+    IncomingMessage msg;
+    while (incoming_buffer_->pop(msg)) {}
+    BinaryMessage frame;
+    while (incoming_frames_->pop(frame)) {}
 }
 
 void Socket_Serial::clearOutBuffer() {
     std::lock_guard<std::mutex> lock(out_buffer_mutex_);
-    outgoing_buffer_.clear();
+    const size_t suffix = framing == Framing::Delimited ? msgDelimiter.size() : 0;
+    std::string msg;
+    while (outgoing_buffer_->pop(msg)) { outgoingBytes_ -= msg.size() + suffix; }
+    releaseBackpressure();
+}
+
+bool Socket_Serial::setQueueCapacity(size_t outgoing, size_t incoming) {
+    if (connectedFlag || connection_thread_.joinable() || serial_thread_.joinable()) { return false; }
+
+    std::lock_guard<std::mutex> outLock(out_buffer_mutex_);
+    std::lock_guard<std::mutex> inLock(in_buffer_mutex_);
+    outgoing_buffer_.reset(new MPSCQueue<std::string>(outgoing));
+    {
+        std::lock_guard<std::mutex> bpLock(backpressure_mutex_);
+        highWaterMessages_ = backpressure_.highMessages(outgoing_buffer_->capacity());
+    }
+    incoming_buffer_.reset(new SPSCQueue<IncomingMessage>(incoming));
+    incoming_frames_.reset(new SPSCQueue<BinaryMessage>(incoming));
+    outgoingBytes_ = 0;
+    return true;
+}
+
+void Socket_Serial::setCoalescing(const CoalescingOptions& options) {
+    {
+        std::lock_guard<std::mutex> lock(out_buffer_mutex_);
+        coalescing_ = options;
+        if (coalescing_.maxBatchBytes == 0) { coalescing_.maxBatchBytes = 1; }
+    }
+    if (connectedFlag) { applySocketOptions(); }
+}
+
+Socket_Serial::CoalescingOptions Socket_Serial::getCoalescing() {
+    std::lock_guard<std::mutex> lock(out_buffer_mutex_);
+    return coalescing_;
+}
+
+void Socket_Serial::applySocketOptions() {
+    bool noDelay = getCoalescing().tcpNoDelay;
+    boost::system::error_code ec;
+    socket_.set_option(boost::asio::ip::tcp::no_delay(noDelay), ec);
+    if (ec && !suppressCatchPrints) { std::cerr << "Failed to set TCP_NODELAY: " << ec.message() << std::endl; }
+#if defined(__linux__)
+    if (kernelTimestamps) {
+        int on = 1;
+        if (::setsockopt(socket_.native_handle(), SOL_SOCKET, SO_TIMESTAMPNS, &on, sizeof(on)) != 0 && !suppressCatchPrints) {
+            std::cerr << "Failed to set SO_TIMESTAMPNS" << std::endl;
+        }
+    }
+#endif
 }
 
 void Socket_Serial::flushSocket() {
@@ -114,49 +462,146 @@ void Socket_Serial::connectionThread() {
     if (!asyncronousFlag) { return; }
 
     bool connectionOneShot = true;
+    int failures = 0;
 
+    // Reconnect state machine: connect -> wait for the link to drop -> reconnect at
+    // once; failed attempts back off. Every wait ends early on disconnect().
     while (!killFlag && (autoReconnect || connectionOneShot)) {
-        if (!connectedFlag)
-        {
-            if (serial_thread_.joinable())
-            { serial_thread_.join(); }
+        if (serial_thread_.joinable())
+        { serial_thread_.join(); }
 
-            doConnection();
+        doConnection();
 
-            if (socket_.is_open()) 
-            {
-                serial_thread_ = std::thread(&Socket_Serial::serialThread, this);
-                connectionOneShot = false;
-            }
+        if (connectedFlag && !killFlag)
+        {
+            if (eventDriven)
+            { serial_thread_ = std::thread(&Socket_Serial::ioThread, this); }
+            else
+            { serial_thread_ = std::thread(&Socket_Serial::serialThread, this); }
+            connectionOneShot = false;
+            failures = 0;
+
+            std::unique_lock<std::mutex> lock(state_mutex_);
+            state_cv_.wait(lock, [this]() { return !connectedFlag || killFlag; });
+        }
+        else
+        {
+            int delay = nextBackoff_ms(failures++);
+            std::unique_lock<std::mutex> lock(state_mutex_);
+            state_cv_.wait_for(lock, std::chrono::milliseconds(delay), [this]() { return killFlag.load(); });
         }
-        std::this_thread::sleep_for(std::chrono::seconds(1));
     }
 }
 
+int Socket_Serial::nextBackoff_ms(int failures) {
+    ReconnectOptions options = getReconnect();
+
+    double delay = options.initialBackoff_ms;
+    for (int i = 0; i < failures && delay < options.maxBackoff_ms; i++) { delay *= options.multiplier; }
+    delay = std::min(delay, static_cast<double>(options.maxBackoff_ms));
+
+    // Jitter keeps a fleet that lost the same peer from reconnecting in lockstep.
+    if (options.jitter > 0) {
+        std::uniform_real_distribution<double> spread(1.0 - options.jitter, 1.0 + options.jitter);
+        delay *= spread(backoffRng_);
+    }
+    return delay > 0 ? static_cast<int>(delay) : 0;
+}
+
+void Socket_Serial::notifyState() {
+    {
+        std::lock_guard<std::mutex> lock(state_mutex_);
+    }
+    state_cv_.notify_all();
+}
+
+void Socket_Serial::setReconnect(const ReconnectOptions& options) {
+    std::lock_guard<std::mutex> lock(state_mutex_);
+    reconnect_ = options;
+}
+
+Socket_Serial::ReconnectOptions Socket_Serial::getReconnect() {
+    std::lock_guard<std::mutex> lock(state_mutex_);
+    return reconnect_;
+}
+
+bool Socket_Serial::openSocket() {
+    // Runs the connect/accept on io_context_ (no io thread exists yet), so a deadline
+    // or disconnect() can cancel it instead of waiting out the OS timeout.
+    bool done = false;
+    boost::system::error_code result;
+
+    io_context_.restart();
+    if (killFlag) { return false; } // disconnect() may have stopped the context before restart()
+
+    if (isServer) {
+        acceptor_ = std::make_shared < boost::asio::ip::tcp::acceptor>(io_context_, endpoints_.front());
+        acceptor_->async_accept(socket_, [&](const boost::system::error_code& error) {
+            result = error;
+            done = true;
+        });
+        io_context_.run();
+    }
+    else {
+        boost::asio::async_connect(socket_, endpoints_,
+            [&](const boost::system::error_code& error, const boost::asio::ip::tcp::endpoint&) {
+                result = error;
+                done = true;
+            });
+        int timeout_ms = getReconnect().connectTimeout_ms;
+        if (timeout_ms > 0) { io_context_.run_for(std::chrono::milliseconds(timeout_ms)); }
+        else { io_context_.run(); }
+    }
+
+    if (!done) {
+        // Deadline passed or disconnect(): abort and let the handler complete.
+        boost::system::error_code ec;
+        socket_.close(ec);
+        if (acceptor_ != nullptr) { acceptor_->close(ec); }
+        io_context_.restart();
+        io_context_.run();
+        result = boost::asio::error::timed_out;
+    }
+
+    if (result) {
+        if (!suppressCatchPrints) { std::cout << "Connection failed: " << result.message() << std::endl; }
+        boost::system::error_code ec;
+        socket_.close(ec);
+        if (!isServer) { endpoints_.clear(); } // re-resolve next time in case the address moved
+        return false;
+    }
+    return true;
+}
+
 void Socket_Serial::doConnection()
 {
     try {
         if (!connectedFlag) {
 
-            boost::asio::ip::tcp::resolver resolver(io_context_);
-            //boost::asio::ip::tcp::resolver::query query(boost::asio::ip::tcp::v4(), IP_Address, port);
-            //boost::asio::ip::tcp::resolver::iterator endpoint_iterator = resolver.resolve(query);
-            auto endpoints = resolver.resolve(IP_Address, port);
-
-            if (isServer) {
-                acceptor_ = std::make_shared < boost::asio::ip::tcp::acceptor>(io_context_, *endpoints.begin());
-                bool acceptError = false;
-                acceptor_->accept(socket_);
-            }
-            else {
-                boost::asio::connect(socket_, endpoints);
+            if (endpoints_.empty()) {
+                boost::asio::ip::tcp::resolver resolver(io_context_);
+                auto results = resolver.resolve(IP_Address, port);
+                endpoints_.clear();
+                for (const auto& entry : results) { endpoints_.push_back(entry.endpoint()); }
             }
 
+            if (!openSocket()) { return; }
+
             if (socket_.is_open()) {
                 socket_.non_blocking(true);
+                applySocketOptions();
                 std::cout << "socket connected" << std::endl;
-                missedHeartbeats = -5; //slight grace period for initial connection.
+                resetLiveness();
+                //drop any partial message left over from a previous connection
+                parser_.reset();
+                frameParser_.configure(framing == Framing::LengthPrefixedCRC, maxFramePayload, frameLookAhead);
+                if (framing == Framing::Delimited) { heartbeatBytes_ = msgDelimiter; }
+                else {
+                    heartbeatBytes_.clear();
+                    FrameParser::encode(heartbeatBytes_, framing == Framing::LengthPrefixedCRC, LINK_CONTROL_HEADER, nullptr, 0);
+                }
                 connectedFlag = true;
+                notifyState();
             }
         }
     }
@@ -209,7 +654,15 @@ void Socket_Serial::closeSocket()
         }
     }
 
+    // Event-driven mode: with the socket closed and the timer cancelled the
+    // io_context runs out of work and the io thread returns.
+    heartbeat_timer_.cancel(ec);
+    cork_timer_.cancel(ec);
+    writeInProgress_ = false;
+    corkArmed_ = false;
+
     connectedFlag = false;
+    notifyState();
 }
 
 void Socket_Serial::serialThread() {
@@ -230,19 +683,27 @@ void Socket_Serial::doSerial()
 void Socket_Serial::sendMessages() {
     if (!connectedFlag) { return; }
 
-    std::lock_guard<std::mutex> lock(out_buffer_mutex_);
-
     try
     {
-        if (!outgoing_buffer_.empty()) {
-            for (const auto& msg : outgoing_buffer_) {
-                boost::asio::write(socket_, boost::asio::buffer(msg));
-                boost::asio::write(socket_, boost::asio::buffer(msgDelimiter));
+        bool wroteData = false;
+
+        // Every queued message goes out as gathered batches of at most maxBatchBytes,
+        // one writev per batch instead of two writes per message. Messages from a
+        // failed batch stay in writing_buffer_ and are resent after a reconnect.
+        if (writeIndex_ < writingCount_ || takeOutgoing(false) > 0) {
+            while (writeIndex_ < writingCount_) {
+                size_t count = buildBatch();
+                if (!writeSequence()) { return; }
+                writeIndex_ += count;
+                wroteData = true;
             }
-            outgoing_buffer_.clear();
         }
-        else {
-            boost::asio::write(socket_, boost::asio::buffer(msgDelimiter));
+
+        // Keepalive only on an idle link.
+        int64_t now = nowTicks();
+        if (!wroteData && keepaliveDue(now)) {
+            write_sequence_.assign(1, boost::asio::buffer(buildKeepalive(now)));
+            writeSequence();
         }
     }
     catch (...) {
@@ -251,48 +712,176 @@ void Socket_Serial::sendMessages() {
     }
 }
 
+int Socket_Serial::takeOutgoing(bool force) {
+    std::lock_guard<std::mutex> lock(out_buffer_mutex_);
+
+    if (outgoing_buffer_->empty()) {
+        releaseBackpressure();
+        return 0;
+    }
+
+    if (!force && coalescing_.corkWindow_us > 0 && outgoingBytes_ < coalescing_.maxBatchBytes &&
+        std::chrono::steady_clock::now().time_since_epoch().count() - firstQueuedTime_ <
+            std::chrono::duration_cast<std::chrono::steady_clock::duration>(std::chrono::microseconds(coalescing_.corkWindow_us)).count()) {
+        return -1; // corked: give more messages a chance to join this write
+    }
+
+    // Swap queue slots with writing_buffer_ slots; both keep their storage.
+    // Bounded by the queue capacity so busy producers cannot keep the writer here.
+    const size_t suffix = framing == Framing::Delimited ? msgDelimiter.size() : 0;
+    const size_t limit = outgoing_buffer_->capacity();
+    size_t bytes = 0;
+    writingCount_ = 0;
+    writeIndex_ = 0;
+    while (writingCount_ < limit) {
+        if (writingCount_ == writing_buffer_.size()) { writing_buffer_.emplace_back(); }
+        if (!outgoing_buffer_->pop(writing_buffer_[writingCount_])) { break; }
+        bytes += writing_buffer_[writingCount_].size() + suffix;
+        ++writingCount_;
+    }
+    outgoingBytes_ -= bytes;
+    batchLimit_ = coalescing_.maxBatchBytes;
+    releaseBackpressure();
+    return writingCount_ > 0 ? 1 : 0;
+}
+
+size_t Socket_Serial::buildBatch() {
+    write_sequence_.clear();
+
+    // Binary frames are queued fully encoded; only delimited messages need a separator.
+    const size_t suffix = framing == Framing::Delimited ? msgDelimiter.size() : 0;
+    size_t bytes = 0;
+    size_t i = writeIndex_;
+    while (i < writingCount_) {
+        const std::string& msg = writing_buffer_[i];
+        // Always take at least one message, even if it alone exceeds the limit.
+        if (i > writeIndex_ && bytes + msg.size() + suffix > batchLimit_) { break; }
+        if (!msg.empty()) { write_sequence_.push_back(boost::asio::buffer(msg)); }
+        if (suffix > 0) { write_sequence_.push_back(boost::asio::buffer(msgDelimiter)); }
+        bytes += msg.size() + suffix;
+        ++i;
+    }
+    return i - writeIndex_;
+}
+
+bool Socket_Serial::writeSequence() {
+    // Blocking write of write_sequence_ on the non-blocking socket: partial
+    // writes advance through the gather list, would_block waits for POLLOUT.
+    size_t first = 0;
+    boost::system::error_code ec;
+
+    while (first < write_sequence_.size()) {
+        size_t n = writeSome(first, ec);
+
+        if (ec == boost::asio::error::would_block || ec == boost::asio::error::try_again) {
+            waitWritable(ec);
+        }
+        if (ec) {
+            if (!suppressCatchPrints) { std::cerr << "Write error: " << ec.message() << std::endl; }
+            closeSocket();
+            return false;
+        }
+
+        while (first < write_sequence_.size() && n >= write_sequence_[first].size()) {
+            n -= write_sequence_[first].size();
+            ++first;
+        }
+        if (first < write_sequence_.size() && n > 0) {
+            write_sequence_[first] = write_sequence_[first] + n;
+        }
+    }
+    lastSendTime_ = nowTicks();
+    return true;
+}
+
+void Socket_Serial::waitWritable(boost::system::error_code& ec) {
+    ec = boost::system::error_code();
+
+#if defined(__unix__) || defined(__APPLE__)
+    // Short poll slices so disconnect() is not stuck behind a peer that stopped reading.
+    pollfd pfd{};
+    pfd.fd = socket_.native_handle();
+    pfd.events = POLLOUT;
+    while (!killFlag) {
+        int rc = ::poll(&pfd, 1, 100);
+        if (rc > 0) { return; }
+        if (rc < 0 && errno != EINTR) {
+            ec = boost::system::error_code(errno, boost::system::system_category());
+            return;
+        }
+    }
+    ec = boost::asio::error::operation_aborted;
+#else
+    // asio's wait() reports would_block right away while the socket is in
+    // user non-blocking mode, so drop out of it for the wait.
+    socket_.non_blocking(false, ec);
+    if (!ec) { socket_.wait(boost::asio::ip::tcp::socket::wait_write, ec); }
+    if (!ec) { socket_.non_blocking(true, ec); }
+#endif
+}
+
+size_t Socket_Serial::writeSome(size_t first, boost::system::error_code& ec) {
+    ec = boost::system::error_code();
+
+#if defined(__unix__) || defined(__APPLE__)
+    // sendmsg directly so one syscall covers up to IOV_MAX buffers
+    // (asio's write_some stops at 64).
+#  ifdef IOV_MAX
+    const size_t maxIov = IOV_MAX < 1024 ? IOV_MAX : 1024;
+#  else
+    const size_t maxIov = 1024;
+#  endif
+    iovec iov[1024];
+    size_t count = std::min(write_sequence_.size() - first, maxIov);
+    for (size_t i = 0; i < count; i++) {
+        iov[i].iov_base = const_cast<void*>(write_sequence_[first + i].data());
+        iov[i].iov_len = write_sequence_[first + i].size();
+    }
+
+    msghdr msg{};
+    msg.msg_iov = iov;
+    msg.msg_iovlen = count;
+
+#  ifdef MSG_NOSIGNAL
+    const int flags = MSG_NOSIGNAL;
+#  else
+    const int flags = 0; // asio sets SO_NOSIGPIPE where MSG_NOSIGNAL is missing
+#  endif
+
+    ssize_t written;
+    do {
+        written = ::sendmsg(socket_.native_handle(), &msg, flags);
+    } while (written < 0 && errno == EINTR);
+
+    if (written < 0) {
+        if (errno == EAGAIN || errno == EWOULDBLOCK) { ec = boost::asio::error::would_block; }
+        else { ec = boost::system::error_code(errno, boost::system::system_category()); }
+        return 0;
+    }
+    return static_cast<size_t>(written);
+#else
+    ConstBufferRange range{ write_sequence_.begin() + first, write_sequence_.end() };
+    return socket_.write_some(range, ec);
+#endif
+}
+
 void Socket_Serial::readMessages() {
     if (!connectedFlag) { return; }
 
     try
     {
-        char buffer[1024];
         boost::system::error_code error;
-        size_t bytes_read = socket_.read_some(boost::asio::buffer(buffer), error);
+        size_t bytes_read = readSome(error);
 
         if (error == boost::asio::error::eof || error == boost::asio::error::would_block) {
-            missedHeartbeats++;
-            if (missedHeartbeats >= missedHeartbeatLimit) {
-                std::cout << "Heartbeat kill: " << missedHeartbeats << std::endl;
+            int64_t silent = nowTicks() - lastReceiveTime_;
+            if (silent >= msToTicks(livenessTimeout_ms())) {
+                std::cout << "Heartbeat kill: " << ticksToMs(silent) << " ms without data" << std::endl;
                 closeSocket();
             }
         }
         else if (!error) {
-            if (bytes_read > 0) {
-                std::string message(buffer, bytes_read);
-                std::string tempRemainder;
-                std::vector<std::string> msgs = splitMessage(message, msgDelimiter, tempRemainder, false);
-                for (int i = 0; i < msgs.size(); i++)
-                {
-                    std::string isolatedMessage = "";
-                    if (i == 0 && inMessageRemainder.size()>0)
-                    { isolatedMessage = inMessageRemainder + msgs[i]; }
-                    else
-                    { isolatedMessage = msgs[i]; }
-
-                    if (isolatedMessage.size() > 0)
-                    {
-                        std::lock_guard<std::mutex> lock(in_buffer_mutex_);
-                        incoming_buffer_.emplace_back(isolatedMessage);
-                    }
-                }
-                if (msgs.size() > 0)
-                { inMessageRemainder = tempRemainder; }
-                else
-                { inMessageRemainder = inMessageRemainder + tempRemainder; }
-                
-                missedHeartbeats = 0;
-            }
+            handleIncoming(bytes_read);
         }
         else
         {
@@ -305,21 +894,514 @@ void Socket_Serial::readMessages() {
     }
 }
 
+boost::asio::mutable_buffer Socket_Serial::prepareRead()
+{
+    return framing == Framing::Delimited ? parser_.prepare() : frameParser_.prepare();
+}
+
+size_t Socket_Serial::readSome(boost::system::error_code& ec)
+{
+    // Reads into the parser and stamps readTiming_ for handleIncoming().
+    boost::asio::mutable_buffer buffer = prepareRead();
+    readTiming_.kernel = RxTiming::TimePoint();
+
+#if defined(__linux__)
+    if (kernelTimestamps) {
+        // recvmsg directly: asio's read_some has no way to return the control message.
+        iovec iov;
+        iov.iov_base = buffer.data();
+        iov.iov_len = buffer.size();
+        alignas(cmsghdr) char control[CMSG_SPACE(sizeof(timespec))];
+        msghdr msg{};
+        msg.msg_iov = &iov;
+        msg.msg_iovlen = 1;
+        msg.msg_control = control;
+        msg.msg_controllen = sizeof(control);
+
+        ssize_t n;
+        do {
+            n = ::recvmsg(socket_.native_handle(), &msg, MSG_DONTWAIT);
+        } while (n < 0 && errno == EINTR);
+        readTiming_.arrival = std::chrono::steady_clock::now();
+
+        if (n < 0) {
+            if (errno == EAGAIN || errno == EWOULDBLOCK) { ec = boost::asio::error::would_block; }
+            else { ec = boost::system::error_code(errno, boost::system::system_category()); }
+            return 0;
+        }
+        if (n == 0) {
+            ec = boost::asio::error::eof;
+            return 0;
+        }
+        ec = boost::system::error_code();
+
+        for (cmsghdr* c = CMSG_FIRSTHDR(&msg); c != nullptr; c = CMSG_NXTHDR(&msg, c)) {
+            if (c->cmsg_level != SOL_SOCKET || c->cmsg_type != SCM_TIMESTAMPNS) { continue; }
+            // The stamp is on CLOCK_REALTIME: carry over how long the data waited in
+            // the socket rather than the wall-clock time itself.
+            timespec stamp;
+            timespec real;
+            std::memcpy(&stamp, CMSG_DATA(c), sizeof(stamp));
+            ::clock_gettime(CLOCK_REALTIME, &real);
+            int64_t waited = (int64_t)(real.tv_sec - stamp.tv_sec) * 1000000000 + (real.tv_nsec - stamp.tv_nsec);
+            if (waited < 0) { waited = 0; }
+            readTiming_.kernel = readTiming_.arrival - std::chrono::nanoseconds(waited);
+        }
+        return static_cast<size_t>(n);
+    }
+#endif
+
+    size_t n = socket_.read_some(buffer, ec);
+    readTiming_.arrival = std::chrono::steady_clock::now();
+    return n;
+}
+
+void Socket_Serial::handleIncoming(size_t bytes_read)
+{
+    if (bytes_read == 0) { return; }
+
+    // Timing: a message that began in an earlier read (the unparsed remainder) keeps
+    // that read's stamps; every later one starts in this read. All are parsed now.
+    const bool carried = (framing == Framing::Delimited ? parser_.remainder().size() : frameParser_.buffered()) > 0;
+    const auto parsedAt = std::chrono::steady_clock::now();
+    size_t parsed = 0;
+    auto stamp = [&]() {
+        rxTiming_ = (parsed++ == 0 && carried) ? pendingTiming_ : readTiming_;
+        rxTiming_.parsed = parsedAt;
+        rxTiming_.dispatched = RxTiming::TimePoint();
+    };
+
+    if (framing == Framing::Delimited) {
+        parser_.commit(bytes_read);
+
+        // One copy per kept message, into a pooled slot; empty messages are heartbeats.
+        size_t delivered = parser_.parse([&](boost::string_view msg) {
+            stamp();
+            if (msg.empty()) { return; }
+            if (msg[0] == PING_PREFIX || msg[0] == PONG_PREFIX) {
+                uint32_t seq = 0;
+                int type = parseLinkControl(msg, seq);
+                if (type != 0) {
+                    handleControl(type, seq);
+                    return;
+                }
+            }
+            if (messageCallback_) {
+                rxTiming_.dispatched = std::chrono::steady_clock::now();
+                messageCallback_(msg);
+                return;
+            }
+            bool queued = incoming_buffer_->emplace([&](IncomingMessage& slot) {
+                slot.text.assign(msg.data(), msg.size());
+                slot.timing = rxTiming_;
+            });
+            if (!queued) { droppedIncoming_++; }
+        });
+        if (delivered > 0) { notifyReceived(); }
+    }
+    else {
+        frameParser_.commit(bytes_read);
+
+        int rc = frameParser_.parse([&](uint8_t header, const uint8_t* bytes, size_t len) {
+            stamp();
+            if (header == LINK_CONTROL_HEADER) {
+                // Empty = keepalive; [type][seq:4] = ping/echo.
+                if (len == 5) {
+                    uint32_t seq = (uint32_t)bytes[1] | ((uint32_t)bytes[2] << 8) |
+                                   ((uint32_t)bytes[3] << 16) | ((uint32_t)bytes[4] << 24);
+                    handleControl(bytes[0], seq);
+                }
+                return;
+            }
+            if (binaryMessageCallback_) {
+                rxTiming_.dispatched = std::chrono::steady_clock::now();
+                binaryMessageCallback_(header, bytes, len);
+                return;
+            }
+            bool queued = incoming_frames_->emplace([&](BinaryMessage& slot) {
+                slot.header = header;
+                slot.bytes.assign(bytes, bytes + len);
+                slot.timing = rxTiming_;
+            });
+            if (!queued) { droppedIncoming_++; }
+        });
+        if (rc < 0) {
+            if (!suppressCatchPrints) { std::cerr << "Frame length exceeds maxFramePayload, dropping connection" << std::endl; }
+            closeSocket();
+            return;
+        }
+        if (rc > 0) { notifyReceived(); }
+    }
+
+    if (parsed > 0 || !carried) { pendingTiming_ = readTiming_; }
+    lastReceiveTime_ = nowTicks();
+}
+
+int Socket_Serial::parseLinkControl(boost::string_view msg, uint32_t& seq)
+{
+    if (msg.size() < 2 || msg.size() > 11) { return 0; }
+    if (msg[0] != PING_PREFIX && msg[0] != PONG_PREFIX) { return 0; }
+
+    uint64_t value = 0;
+    for (size_t i = 1; i < msg.size(); i++) {
+        if (msg[i] < '0' || msg[i] > '9') { return 0; }
+        value = value * 10 + (msg[i] - '0');
+    }
+    if (value > 0xFFFFFFFFull) { return 0; }
+
+    seq = static_cast<uint32_t>(value);
+    return msg[0] == PING_PREFIX ? CONTROL_PING : CONTROL_PONG;
+}
+
+void Socket_Serial::handleControl(int type, uint32_t seq)
+{
+    if (type == CONTROL_PING) {
+        // Echo through the normal queue, so it is ordered with (and batched into) data.
+        std::string pong;
+        if (framing == Framing::Delimited) {
+            pong.push_back(PONG_PREFIX);
+            pong += std::to_string(seq);
+        }
+        else {
+            uint8_t payload[5] = { CONTROL_PONG, (uint8_t)(seq & 0xFF), (uint8_t)((seq >> 8) & 0xFF),
+                                   (uint8_t)((seq >> 16) & 0xFF), (uint8_t)((seq >> 24) & 0xFF) };
+            FrameParser::encode(pong, framing == Framing::LengthPrefixedCRC, LINK_CONTROL_HEADER, payload, 5);
+        }
+        const size_t bytes = pong.size() + (framing == Framing::Delimited ? msgDelimiter.size() : 0);
+        noteQueued(bytes);
+        if (!outgoing_buffer_->push(pong)) {
+            outgoingBytes_ -= bytes;
+            return;
+        }
+        postFlush();
+    }
+    else if (type == CONTROL_PONG) {
+        // Only the newest ping is tracked; echoes of superseded pings are ignored.
+        if (pingSentTime_ == 0 || seq != pingSeq_) { return; }
+
+        int64_t rtt = std::chrono::duration_cast<std::chrono::nanoseconds>(toDuration(nowTicks() - pingSentTime_)).count();
+        pingSentTime_ = 0;
+
+        int64_t smoothed = rttSmoothed_ns_;
+        int64_t lowest = rttMin_ns_;
+        rttLast_ns_ = rtt;
+        rttSmoothed_ns_ = smoothed < 0 ? rtt : smoothed + (rtt - smoothed) / 8;
+        if (lowest < 0 || rtt < lowest) { rttMin_ns_ = rtt; }
+        rttSamples_++;
+    }
+}
+
+// ===== Liveness =====
+
+int64_t Socket_Serial::nowTicks()
+{
+    return std::chrono::steady_clock::now().time_since_epoch().count();
+}
+
+void Socket_Serial::resetLiveness()
+{
+    int64_t now = nowTicks();
+    lastReceiveTime_ = now;
+    lastSendTime_ = now;
+    pingSentTime_ = 0;
+}
+
+int Socket_Serial::keepaliveInterval_ms()
+{
+    std::lock_guard<std::mutex> lock(liveness_mutex_);
+    if (liveness_.keepaliveInterval_ms > 0) { return liveness_.keepaliveInterval_ms; }
+    return period_ms > 0 ? period_ms : 1;
+}
+
+int Socket_Serial::livenessTimeout_ms()
+{
+    std::lock_guard<std::mutex> lock(liveness_mutex_);
+    if (liveness_.timeout_ms > 0) { return liveness_.timeout_ms; }
+    return missedHeartbeatLimit * (period_ms > 0 ? period_ms : 1);
+}
+
+bool Socket_Serial::keepaliveDue(int64_t now)
+{
+    return now - lastSendTime_ >= msToTicks(keepaliveInterval_ms());
+}
+
+const std::string& Socket_Serial::buildKeepalive(int64_t now)
+{
+    keepalivesSent_++;
+
+    bool measureRtt;
+    {
+        std::lock_guard<std::mutex> lock(liveness_mutex_);
+        measureRtt = liveness_.measureRtt;
+    }
+    if (!measureRtt) { return heartbeatBytes_; }
+
+    // A fresh ping every time; an unanswered one is simply superseded.
+    pingSeq_++;
+    pingSentTime_ = now;
+    keepaliveBytes_.clear();
+    if (framing == Framing::Delimited) {
+        keepaliveBytes_.push_back(PING_PREFIX);
+        keepaliveBytes_ += std::to_string(pingSeq_);
+        keepaliveBytes_ += msgDelimiter;
+    }
+    else {
+        std::string payload(1, static_cast<char>(CONTROL_PING));
+        putU32(payload, pingSeq_);
+        FrameParser::encode(keepaliveBytes_, framing == Framing::LengthPrefixedCRC, LINK_CONTROL_HEADER,
+                            reinterpret_cast<const uint8_t*>(payload.data()), 5);
+    }
+    return keepaliveBytes_;
+}
+
+void Socket_Serial::setLiveness(const LivenessOptions& options)
+{
+    std::lock_guard<std::mutex> lock(liveness_mutex_);
+    liveness_ = options;
+}
+
+Socket_Serial::LivenessOptions Socket_Serial::getLiveness()
+{
+    std::lock_guard<std::mutex> lock(liveness_mutex_);
+    return liveness_;
+}
+
+Socket_Serial::LivenessStatus Socket_Serial::getLivenessStatus()
+{
+    LivenessStatus status;
+    status.connected = connectedFlag;
+    if (status.connected) {
+        int64_t now = nowTicks();
+        status.sinceLastReceive_ms = ticksToMs(now - lastReceiveTime_);
+        status.sinceLastSend_ms = ticksToMs(now - lastSendTime_);
+    }
+    const double nsPerMs = 1e6;
+    int64_t rtt = rttLast_ns_;
+    if (rtt >= 0) {
+        status.rttLast_ms = rtt / nsPerMs;
+        status.rttSmoothed_ms = rttSmoothed_ns_ / nsPerMs;
+        status.rttMin_ms = rttMin_ns_ / nsPerMs;
+    }
+    status.rttSamples = rttSamples_;
+    status.keepalivesSent = keepalivesSent_;
+    return status;
+}
+
+bool Socket_Serial::hasReceived()
+{
+    return !incoming_buffer_->empty() || !incoming_frames_->empty();
+}
+
+void Socket_Serial::notifyReceived()
+{
+    // Pairs with the fence in waitForMessages(): either the waiter sees the queued
+    // message in its predicate, or we see the waiter and notify it.
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    if (rxWaiters_.load() > 0) {
+        std::lock_guard<std::mutex> lock(rx_wait_mutex_);
+        rx_wait_cv_.notify_all();
+    }
+}
+
+bool Socket_Serial::waitForMessages(int timeout_ms)
+{
+    if (hasReceived()) { return true; }
+    if (!asyncronousFlag) { return false; } // nothing would ever fill the queue while we wait
+
+    std::unique_lock<std::mutex> lock(rx_wait_mutex_);
+    rxWaiters_++;
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+
+    auto ready = [this]() { return hasReceived() || killFlag; };
+    if (timeout_ms < 0) { rx_wait_cv_.wait(lock, ready); }
+    else { rx_wait_cv_.wait_for(lock, std::chrono::milliseconds(timeout_ms), ready); }
+
+    rxWaiters_--;
+    return hasReceived();
+}
+
+// ===== Event-driven mode =====
+// Everything below runs on the io thread, so the socket, the parser state and
+// the write bookkeeping need no extra locking. Handlers that complete with
+// operation_aborted belong to a socket that closeSocket() already tore down.
+
+void Socket_Serial::ioThread() {
+    if (!asyncronousFlag) { return; }
+
+    writeInProgress_ = false;
+
+    io_context_.restart();
+    if (killFlag) { return; } // disconnect() may have stopped the context before restart()
+    startRead();
+    startHeartbeat(keepaliveInterval_ms());
+    startWrite(); // anything queued while disconnected
+
+    try
+    {
+        io_context_.run();
+    }
+    catch (const std::exception& e) {
+        if (!suppressCatchPrints) { std::cerr << "IO exception: " << e.what() << std::endl; }
+        closeSocket();
+    }
+}
+
+void Socket_Serial::startRead() {
+    if (!connectedFlag) { return; }
+
+#if defined(__linux__)
+    if (kernelTimestamps) {
+        // Wait for readability only; handleRead() reads with readSome(), which
+        // fetches the kernel timestamp.
+        socket_.async_wait(boost::asio::ip::tcp::socket::wait_read,
+            [this](const boost::system::error_code& error) {
+                handleRead(error, 0);
+            });
+        return;
+    }
+#endif
+    socket_.async_read_some(prepareRead(),
+        [this](const boost::system::error_code& error, size_t bytes_read) {
+            handleRead(error, bytes_read);
+        });
+}
+
+void Socket_Serial::handleRead(const boost::system::error_code& error, size_t bytes_read) {
+    if (error == boost::asio::error::operation_aborted || !connectedFlag) { return; }
+
+    if (error) {
+        // eof or a hard socket error: the peer is gone.
+        closeSocket();
+        return;
+    }
+
+    if (bytes_read > 0) {
+        readTiming_.arrival = std::chrono::steady_clock::now();
+        readTiming_.kernel = RxTiming::TimePoint();
+        handleIncoming(bytes_read);
+    }
+
+    // Drain whatever else the kernel already has before re-arming the reactor.
+    // The socket is in non-blocking mode, so this stops at would_block.
+    boost::system::error_code ec;
+    while (connectedFlag) {
+        size_t n = readSome(ec);
+        if (ec == boost::asio::error::would_block || ec == boost::asio::error::try_again) { break; }
+        if (ec) {
+            closeSocket();
+            return;
+        }
+        handleIncoming(n);
+    }
+
+    startRead();
+}
+
+void Socket_Serial::startWrite(bool heartbeat, bool uncork) {
+    if (!connectedFlag || writeInProgress_) { return; }
+
+    if (writeIndex_ >= writingCount_) {
+        // A heartbeat tick also flushes corked messages; the tick bounds their delay.
+        int taken = takeOutgoing(heartbeat || uncork);
+        if (taken < 0) {
+            armCork(getCoalescing().corkWindow_us);
+            return;
+        }
+    }
+
+    size_t count = buildBatch();
+    if (count == 0) {
+        if (!heartbeat) { return; }
+        write_sequence_.assign(1, boost::asio::buffer(buildKeepalive(nowTicks())));
+    }
+    writeBatchCount_ = count;
+
+    writeInProgress_ = true;
+    lastSendTime_ = nowTicks();
+    boost::asio::async_write(socket_, write_sequence_,
+        [this](const boost::system::error_code& error, size_t) {
+            handleWrite(error);
+        });
+}
+
+void Socket_Serial::armCork(int window_us) {
+    if (corkArmed_) { return; }
+
+    corkArmed_ = true;
+    cork_timer_.expires_after(std::chrono::microseconds(window_us));
+    cork_timer_.async_wait([this](const boost::system::error_code& error) {
+        corkArmed_ = false;
+        if (error == boost::asio::error::operation_aborted) { return; }
+        startWrite(false, true);
+    });
+}
+
+void Socket_Serial::handleWrite(const boost::system::error_code& error) {
+    if (error == boost::asio::error::operation_aborted) { return; }
+
+    writeInProgress_ = false;
+
+    if (error) {
+        // The batch stays pending and goes out again after a reconnect.
+        if (!suppressCatchPrints) { std::cerr << "Write error: " << error.message() << std::endl; }
+        closeSocket();
+        return;
+    }
+    writeIndex_ += writeBatchCount_;
+    writeBatchCount_ = 0;
+
+    // Rest of the taken batch, then anything queued while this write was in flight.
+    startWrite();
+}
+
+void Socket_Serial::startHeartbeat(int delay_ms) {
+    if (!connectedFlag) { return; }
+
+    heartbeat_timer_.expires_after(std::chrono::milliseconds(delay_ms > 0 ? delay_ms : 1));
+    heartbeat_timer_.async_wait([this](const boost::system::error_code& error) {
+        handleHeartbeat(error);
+    });
+}
+
+void Socket_Serial::handleHeartbeat(const boost::system::error_code& error) {
+    if (error == boost::asio::error::operation_aborted || !connectedFlag) { return; }
+
+    // Same contract as the polling loop: a keepalive once the link has been idle
+    // for the keepalive interval, a kill once nothing arrived for the timeout.
+    // The timer sleeps until whichever of the two comes first.
+    int64_t now = nowTicks();
+    if (keepaliveDue(now)) { startWrite(true); }
+
+    const int64_t timeout = msToTicks(livenessTimeout_ms());
+    const int64_t silent = now - lastReceiveTime_;
+    if (silent >= timeout) {
+        std::cout << "Heartbeat kill: " << ticksToMs(silent) << " ms without data" << std::endl;
+        closeSocket();
+        return;
+    }
+
+    // A write still in flight counts as activity; check again one interval later.
+    const int64_t interval = msToTicks(keepaliveInterval_ms());
+    int64_t untilKeepalive = lastSendTime_ + interval - now;
+    if (untilKeepalive <= 0) { untilKeepalive = interval; }
+    const int64_t next = std::min(untilKeepalive, timeout - silent);
+    startHeartbeat(static_cast<int>(std::ceil(ticksToMs(next))));
+}
+
 std::vector<std::string> Socket_Serial::splitMessage(const std::string& message, const std::string& delimiter, std::string& remainder,bool appendRemainder ) {
-    std::string inMsg = message;
+    // Walks the message once with an advancing offset; no working copy, no front erases.
     std::vector<std::string> messages;
+    size_t start = 0;
     size_t pos = 0;
-    std::string token;
 
-    while ((pos = inMsg.find(delimiter)) != std::string::npos) {
-        token = inMsg.substr(0, pos);
-        messages.push_back(token);
-        inMsg.erase(0, pos + delimiter.length());
+    while ((pos = message.find(delimiter, start)) != std::string::npos) {
+        messages.emplace_back(message, start, pos - start);
+        start = pos + delimiter.length();
     }
 
-    if (!inMsg.empty()) {
-        remainder = inMsg;
-        if(appendRemainder){messages.push_back(inMsg);}
+    if (start < message.size()) {
+        remainder.assign(message, start, std::string::npos);
+        if(appendRemainder){messages.push_back(remainder);}
     }
 
     return messages;
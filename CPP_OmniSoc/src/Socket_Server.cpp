@@ -0,0 +1,515 @@
+#include "Socket_Server.h"
+#include "Socket_Serial.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <iostream>
+#include <iterator>
+
+namespace {
+int64_t nowTicks() {
+    return std::chrono::steady_clock::now().time_since_epoch().count();
+}
+
+int64_t msToTicks(int ms) {
+    return std::chrono::duration_cast<std::chrono::steady_clock::duration>(std::chrono::milliseconds(ms)).count();
+}
+
+double ticksToMs(int64_t ticks) {
+    return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::duration(ticks)).count();
+}
+}
+
+// ===== Socket_Session =====
+// Everything except the public queue accessors runs on the session's strand
+// (the socket's executor), so socket, parser and write bookkeeping need no
+// locking even with several worker threads.
+
+Socket_Session::Socket_Session(int _id, boost::asio::ip::tcp::socket socket, Socket_Server& _server)
+    : id_(_id), server_(_server), socket_(std::move(socket)), heartbeat_timer_(socket_.get_executor()),
+      parser_(_server.msgDelimiter) {
+
+    boost::system::error_code ec;
+    auto endpoint = socket_.remote_endpoint(ec);
+    if (!ec) { remoteAddress_ = endpoint.address().to_string() + ":" + std::to_string(endpoint.port()); }
+}
+
+void Socket_Session::send(const std::string& msg) {
+    send(std::make_shared<const std::string>(msg));
+}
+
+void Socket_Session::send(const SharedMessage& msg) {
+    if (!connectedFlag) { return; }
+
+    {
+        std::lock_guard<std::mutex> lock(out_buffer_mutex_);
+        outgoing_buffer_.push_back(msg);
+    }
+    postFlush();
+}
+
+std::vector<std::string> Socket_Session::receive(int count) {
+    std::vector<std::string> messages;
+    bool drained;
+    {
+        std::lock_guard<std::mutex> lock(in_buffer_mutex_);
+
+        if (count == -1) {
+            messages = std::move(incoming_buffer_);
+            incoming_buffer_.clear();
+        }
+        else {
+            int num_messages = std::min(count, static_cast<int>(incoming_buffer_.size()));
+            messages.insert(messages.end(), std::make_move_iterator(incoming_buffer_.begin()),
+                            std::make_move_iterator(incoming_buffer_.begin() + num_messages));
+            incoming_buffer_.erase(incoming_buffer_.begin(), incoming_buffer_.begin() + num_messages);
+        }
+        drained = incoming_buffer_.empty();
+    }
+
+    // A closed session stays listed until what it received has been taken.
+    if (drained && !connectedFlag) { server_.removeSession(id_); }
+    return messages;
+}
+
+void Socket_Session::clearInBuffer() {
+    std::lock_guard<std::mutex> lock(in_buffer_mutex_);
+    incoming_buffer_.clear();
+}
+
+void Socket_Session::clearOutBuffer() {
+    std::lock_guard<std::mutex> lock(out_buffer_mutex_);
+    outgoing_buffer_.clear();
+}
+
+void Socket_Session::close() {
+    auto self = shared_from_this();
+    boost::asio::post(socket_.get_executor(), [self]() { self->closeSocket(); });
+}
+
+void Socket_Session::start() {
+    const int64_t now = nowTicks();
+    lastReceiveTime_ = now;
+    lastSendTime_ = now;
+
+    auto self = shared_from_this();
+    boost::asio::post(socket_.get_executor(), [self]() {
+        self->startRead();
+        self->startHeartbeat(self->server_.keepaliveInterval_ms());
+    });
+}
+
+void Socket_Session::postFlush() {
+    // One pending flush picks up everything queued before it runs.
+    if (flushPosted_.exchange(true)) { return; }
+
+    auto self = shared_from_this();
+    boost::asio::post(socket_.get_executor(), [self]() {
+        self->flushPosted_ = false;
+        self->startWrite();
+    });
+}
+
+void Socket_Session::startRead() {
+    if (!connectedFlag) { return; }
+
+    auto self = shared_from_this();
+    socket_.async_read_some(parser_.prepare(),
+        [self](const boost::system::error_code& error, size_t bytes_read) {
+            self->handleRead(error, bytes_read);
+        });
+}
+
+void Socket_Session::handleRead(const boost::system::error_code& error, size_t bytes_read) {
+    if (error == boost::asio::error::operation_aborted || !connectedFlag) { return; }
+
+    if (error) {
+        closeSocket();
+        return;
+    }
+
+    handleIncoming(bytes_read);
+
+    // Drain until would_block before re-arming the reactor.
+    boost::system::error_code ec;
+    while (connectedFlag) {
+        size_t n = socket_.read_some(parser_.prepare(), ec);
+        if (ec == boost::asio::error::would_block || ec == boost::asio::error::try_again) { break; }
+        if (ec) {
+            closeSocket();
+            return;
+        }
+        handleIncoming(n);
+    }
+
+    startRead();
+}
+
+void Socket_Session::handleIncoming(size_t bytes_read) {
+    if (bytes_read == 0) { return; }
+
+    parser_.commit(bytes_read);
+    uint32_t pingSeq = 0;
+    bool pinged = false;
+    uint32_t pongSeq = 0;
+    bool ponged = false;
+    {
+        std::lock_guard<std::mutex> lock(in_buffer_mutex_);
+        parser_.parse([&](boost::string_view msg) {
+            if (msg.empty()) { return; }
+            // Echo Socket_Serial RTT pings; the answer to the newest one is enough.
+            uint32_t seq = 0;
+            int control = Socket_Serial::parseLinkControl(msg, seq);
+            if (control == Socket_Serial::CONTROL_PING) {
+                pingSeq = seq;
+                pinged = true;
+            }
+            else if (control == Socket_Serial::CONTROL_PONG) {
+                pongSeq = seq;
+                ponged = true;
+            }
+            if (control == 0) { incoming_buffer_.emplace_back(msg.data(), msg.size()); }
+        });
+    }
+    if (pinged) { send(std::string(1, Socket_Serial::PONG_PREFIX) + std::to_string(pingSeq)); }
+    if (ponged) { handlePong(pongSeq); }
+
+    lastReceiveTime_ = nowTicks();
+}
+
+void Socket_Session::handlePong(uint32_t seq) {
+    // Only the newest ping is tracked; echoes of superseded pings are ignored.
+    if (pingSentTime_ == 0 || seq != pingSeq_) { return; }
+
+    int64_t rtt = std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::duration(nowTicks() - pingSentTime_)).count();
+    pingSentTime_ = 0;
+
+    int64_t smoothed = rttSmoothed_ns_;
+    int64_t lowest = rttMin_ns_;
+    rttLast_ns_ = rtt;
+    rttSmoothed_ns_ = smoothed < 0 ? rtt : smoothed + (rtt - smoothed) / 8;
+    if (lowest < 0 || rtt < lowest) { rttMin_ns_ = rtt; }
+    rttSamples_++;
+}
+
+const std::string& Socket_Session::buildKeepalive(int64_t now) {
+    keepalivesSent_++;
+    if (!server_.liveness.measureRtt) { return server_.msgDelimiter; }
+
+    // A fresh ping every time; an unanswered one is simply superseded.
+    pingSeq_++;
+    pingSentTime_ = now;
+    keepaliveBytes_.assign(1, Socket_Serial::PING_PREFIX);
+    keepaliveBytes_ += std::to_string(pingSeq_);
+    keepaliveBytes_ += server_.msgDelimiter;
+    return keepaliveBytes_;
+}
+
+Socket_Serial::LivenessStatus Socket_Session::getLivenessStatus() {
+    Socket_Serial::LivenessStatus status;
+    status.connected = connectedFlag;
+    if (status.connected) {
+        int64_t now = nowTicks();
+        status.sinceLastReceive_ms = ticksToMs(now - lastReceiveTime_);
+        status.sinceLastSend_ms = ticksToMs(now - lastSendTime_);
+    }
+    const double nsPerMs = 1e6;
+    int64_t rtt = rttLast_ns_;
+    if (rtt >= 0) {
+        status.rttLast_ms = rtt / nsPerMs;
+        status.rttSmoothed_ms = rttSmoothed_ns_ / nsPerMs;
+        status.rttMin_ms = rttMin_ns_ / nsPerMs;
+    }
+    status.rttSamples = rttSamples_;
+    status.keepalivesSent = keepalivesSent_;
+    return status;
+}
+
+void Socket_Session::startWrite(bool heartbeat) {
+    if (!connectedFlag || writeInProgress_) { return; }
+
+    if (writeIndex_ >= writing_buffer_.size()) {
+        writing_buffer_.clear();
+        writeIndex_ = 0;
+        std::lock_guard<std::mutex> lock(out_buffer_mutex_);
+        writing_buffer_.swap(outgoing_buffer_);
+    }
+
+    // Gather as many queued messages as fit in maxBatchBytes (at least one).
+    const std::string& delimiter = server_.msgDelimiter;
+    write_sequence_.clear();
+    size_t bytes = 0;
+    size_t i = writeIndex_;
+    while (i < writing_buffer_.size()) {
+        const std::string& msg = *writing_buffer_[i];
+        if (i > writeIndex_ && bytes + msg.size() + delimiter.size() > server_.maxBatchBytes) { break; }
+        if (!msg.empty()) { write_sequence_.push_back(boost::asio::buffer(msg)); }
+        write_sequence_.push_back(boost::asio::buffer(delimiter));
+        bytes += msg.size() + delimiter.size();
+        ++i;
+    }
+    writeIndex_ = i;
+
+    if (write_sequence_.empty()) {
+        if (!heartbeat) { return; }
+        write_sequence_.push_back(boost::asio::buffer(buildKeepalive(nowTicks())));
+    }
+
+    writeInProgress_ = true;
+    lastSendTime_ = nowTicks();
+    auto self = shared_from_this();
+    boost::asio::async_write(socket_, write_sequence_,
+        [self](const boost::system::error_code& error, size_t) {
+            self->handleWrite(error);
+        });
+}
+
+void Socket_Session::handleWrite(const boost::system::error_code& error) {
+    if (error == boost::asio::error::operation_aborted) { return; }
+
+    writeInProgress_ = false;
+
+    if (error) {
+        if (!server_.suppressCatchPrints) { std::cerr << "Session " << id_ << " write error: " << error.message() << std::endl; }
+        closeSocket();
+        return;
+    }
+
+    startWrite();
+}
+
+void Socket_Session::startHeartbeat(int delay_ms) {
+    if (!connectedFlag) { return; }
+
+    auto self = shared_from_this();
+    heartbeat_timer_.expires_after(std::chrono::milliseconds(delay_ms > 0 ? delay_ms : 1));
+    heartbeat_timer_.async_wait([self](const boost::system::error_code& error) {
+        self->handleHeartbeat(error);
+    });
+}
+
+void Socket_Session::handleHeartbeat(const boost::system::error_code& error) {
+    if (error == boost::asio::error::operation_aborted || !connectedFlag) { return; }
+
+    // Same contract as Socket_Serial::handleHeartbeat(): a keepalive once the link
+    // has been idle for the keepalive interval, a kill once nothing arrived for the
+    // timeout. The timer sleeps until whichever of the two comes first.
+    const int64_t now = nowTicks();
+    const int64_t interval = msToTicks(server_.keepaliveInterval_ms());
+    if (now - lastSendTime_ >= interval) { startWrite(true); }
+
+    const int64_t timeout = msToTicks(server_.livenessTimeout_ms());
+    const int64_t silent = now - lastReceiveTime_;
+    if (silent >= timeout) {
+        std::cout << "Session " << id_ << " heartbeat kill: " << ticksToMs(silent) << " ms without data" << std::endl;
+        closeSocket();
+        return;
+    }
+
+    // A write still in flight counts as activity; check again one interval later.
+    int64_t untilKeepalive = lastSendTime_ + interval - now;
+    if (untilKeepalive <= 0) { untilKeepalive = interval; }
+    const int64_t next = std::min(untilKeepalive, timeout - silent);
+    startHeartbeat(static_cast<int>(std::ceil(ticksToMs(next))));
+}
+
+void Socket_Session::closeSocket() {
+    if (!connectedFlag.exchange(false)) { return; }
+
+    std::cout << "Session " << id_ << " closed" << std::endl;
+
+    boost::system::error_code ec;
+    socket_.shutdown(boost::asio::ip::tcp::socket::shutdown_both, ec);
+    socket_.close(ec);
+    if (ec && !server_.suppressCatchPrints) {
+        std::cerr << "Failed to close session socket: " << ec.message() << std::endl;
+    }
+    heartbeat_timer_.cancel(ec);
+
+    // Messages the client sent before it went away are still handed out by
+    // receive(), which drops the session once they are taken.
+    bool drained;
+    {
+        std::lock_guard<std::mutex> lock(in_buffer_mutex_);
+        drained = incoming_buffer_.empty();
+    }
+    if (drained) { server_.removeSession(id_); }
+}
+
+// ===== Socket_Server =====
+
+Socket_Server::Socket_Server(const std::string& _IP_Address, const std::string& _port, int _threadCount)
+    : io_context_(), acceptor_(io_context_) {
+
+    IP_Address = _IP_Address;
+    port = _port;
+    threadCount = _threadCount > 0 ? _threadCount : 1;
+}
+
+Socket_Server::~Socket_Server() {
+    stop();
+}
+
+bool Socket_Server::start(int _period_ms) {
+    if (listeningFlag) { return true; }
+
+    period_ms = _period_ms;
+
+    try
+    {
+        boost::asio::ip::tcp::resolver resolver(io_context_);
+        boost::asio::ip::tcp::endpoint endpoint = *resolver.resolve(IP_Address, port).begin();
+
+        acceptor_.open(endpoint.protocol());
+        acceptor_.set_option(boost::asio::ip::tcp::acceptor::reuse_address(true));
+        acceptor_.bind(endpoint);
+        acceptor_.listen();
+    }
+    catch (const std::exception& e) {
+        if (!suppressCatchPrints) { std::cout << "Listen Exception: " << e.what() << std::endl; }
+        boost::system::error_code ec;
+        acceptor_.close(ec);
+        return false;
+    }
+
+    listeningFlag = true;
+    io_context_.restart();
+    work_.reset(new boost::asio::executor_work_guard<boost::asio::io_context::executor_type>(io_context_.get_executor()));
+    startAccept();
+
+    for (int i = 0; i < threadCount; i++) {
+        worker_threads_.emplace_back([this]() {
+            try
+            {
+                io_context_.run();
+            }
+            catch (const std::exception& e) {
+                if (!suppressCatchPrints) { std::cerr << "Server worker exception: " << e.what() << std::endl; }
+            }
+        });
+    }
+
+    std::cout << "server listening" << std::endl;
+    return true;
+}
+
+void Socket_Server::stop() {
+    if (!listeningFlag.exchange(false)) { return; }
+
+    boost::asio::post(io_context_, [this]() {
+        boost::system::error_code ec;
+        acceptor_.close(ec);
+    });
+
+    std::map<int, std::shared_ptr<Socket_Session>> sessions;
+    {
+        std::lock_guard<std::mutex> lock(sessions_mutex_);
+        sessions = sessions_;
+    }
+    for (auto& session : sessions) {
+        session.second->close();
+    }
+
+    // With the acceptor and every session closed, the workers run out of work and return.
+    work_.reset();
+    for (auto& thread : worker_threads_) {
+        if (thread.joinable()) { thread.join(); }
+    }
+    worker_threads_.clear();
+
+    std::lock_guard<std::mutex> lock(sessions_mutex_);
+    sessions_.clear();
+    std::cout << "server stopped" << std::endl;
+}
+
+bool Socket_Server::send(int clientId, const std::string& msg) {
+    auto session = getSession(clientId);
+    if (session == nullptr || !session->isConnected()) { return false; }
+
+    session->send(msg);
+    return true;
+}
+
+void Socket_Server::broadcast(const std::string& msg) {
+    auto shared = std::make_shared<const std::string>(msg);
+
+    std::lock_guard<std::mutex> lock(sessions_mutex_);
+    for (auto& session : sessions_) {
+        session.second->send(shared);
+    }
+}
+
+std::vector<std::string> Socket_Server::receive(int clientId, int count) {
+    auto session = getSession(clientId);
+    if (session == nullptr) { return std::vector<std::string>(); }
+
+    return session->receive(count);
+}
+
+std::shared_ptr<Socket_Session> Socket_Server::getSession(int clientId) {
+    std::lock_guard<std::mutex> lock(sessions_mutex_);
+    auto it = sessions_.find(clientId);
+    return it == sessions_.end() ? nullptr : it->second;
+}
+
+std::vector<int> Socket_Server::getClientIds() {
+    std::vector<int> ids;
+    std::lock_guard<std::mutex> lock(sessions_mutex_);
+    for (auto& session : sessions_) { ids.push_back(session.first); }
+    return ids;
+}
+
+size_t Socket_Server::clientCount() {
+    std::lock_guard<std::mutex> lock(sessions_mutex_);
+    return sessions_.size();
+}
+
+void Socket_Server::startAccept() {
+    // Each accepted socket gets its own strand so a session's handlers never run concurrently.
+    acceptor_.async_accept(boost::asio::make_strand(io_context_),
+        [this](const boost::system::error_code& error, boost::asio::ip::tcp::socket socket) {
+            handleAccept(error, std::move(socket));
+        });
+}
+
+void Socket_Server::handleAccept(const boost::system::error_code& error, boost::asio::ip::tcp::socket socket) {
+    if (error == boost::asio::error::operation_aborted || !listeningFlag) { return; }
+
+    if (error) {
+        if (!suppressCatchPrints) { std::cout << "Accept error: " << error.message() << std::endl; }
+    }
+    else {
+        boost::system::error_code ec;
+        socket.non_blocking(true, ec);
+        socket.set_option(boost::asio::ip::tcp::no_delay(tcpNoDelay), ec);
+
+        std::shared_ptr<Socket_Session> session;
+        {
+            std::lock_guard<std::mutex> lock(sessions_mutex_);
+            int clientId = nextClientId++;
+            session = std::make_shared<Socket_Session>(clientId, std::move(socket), *this);
+            sessions_[clientId] = session;
+        }
+        std::cout << "client " << session->id() << " connected " << session->remoteAddress() << std::endl;
+        session->start();
+    }
+
+    startAccept();
+}
+
+int Socket_Server::keepaliveInterval_ms() const {
+    if (liveness.keepaliveInterval_ms > 0) { return liveness.keepaliveInterval_ms; }
+    return period_ms > 0 ? period_ms : 1;
+}
+
+int Socket_Server::livenessTimeout_ms() const {
+    if (liveness.timeout_ms > 0) { return liveness.timeout_ms; }
+    return missedHeartbeatLimit * (period_ms > 0 ? period_ms : 1);
+}
+
+void Socket_Server::removeSession(int clientId) {
+    std::lock_guard<std::mutex> lock(sessions_mutex_);
+    sessions_.erase(clientId);
+}
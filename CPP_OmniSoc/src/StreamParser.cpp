@@ -0,0 +1,149 @@
+#include "StreamParser.h"
+#include "CRC16.h"
+
+#include <algorithm>
+#include <cstring>
+
+ReceiveBuffer::ReceiveBuffer(size_t initialCapacity)
+    : storage_(initialCapacity > 0 ? initialCapacity : 1) {}
+
+boost::asio::mutable_buffer ReceiveBuffer::prepare(size_t minSize) {
+    if (storage_.size() - tail_ < minSize) {
+        size_t used = size();
+        if (head_ > 0 && storage_.size() - used >= minSize) {
+            // Enough room once the unconsumed bytes move to the front.
+            std::memmove(storage_.data(), storage_.data() + head_, used);
+        }
+        else {
+            std::vector<char> grown(std::max(storage_.size() * 2, used + minSize));
+            std::memcpy(grown.data(), storage_.data() + head_, used);
+            storage_.swap(grown);
+        }
+        head_ = 0;
+        tail_ = used;
+    }
+    return boost::asio::buffer(storage_.data() + tail_, storage_.size() - tail_);
+}
+
+void ReceiveBuffer::commit(size_t n) {
+    tail_ = std::min(tail_ + n, storage_.size());
+}
+
+void ReceiveBuffer::consume(size_t n) {
+    head_ += std::min(n, size());
+    if (head_ == tail_) {
+        head_ = 0;
+        tail_ = 0;
+    }
+}
+
+void ReceiveBuffer::clear() {
+    head_ = 0;
+    tail_ = 0;
+}
+
+DelimiterParser::DelimiterParser(const std::string& delimiter, size_t initialCapacity)
+    : buffer_(initialCapacity), delimiter_(delimiter.empty() ? std::string(";") : delimiter) {}
+
+void DelimiterParser::reset() {
+    buffer_.clear();
+    scanned_ = 0;
+}
+
+const char* DelimiterParser::findDelimiter(const char* from, const char* end) const {
+    const size_t delimLen = delimiter_.size();
+    const char first = delimiter_[0];
+
+    while (from + delimLen <= end) {
+        const char* hit = static_cast<const char*>(std::memchr(from, first, (end - from) - (delimLen - 1)));
+        if (hit == nullptr) { return nullptr; }
+        if (delimLen == 1 || std::memcmp(hit + 1, delimiter_.data() + 1, delimLen - 1) == 0) { return hit; }
+        from = hit + 1;
+    }
+    return nullptr;
+}
+
+FrameParser::FrameParser(bool withCrc, size_t maxPayload, size_t initialCapacity)
+    : buffer_(initialCapacity), crc_(withCrc), maxPayload_(maxPayload) {}
+
+void FrameParser::configure(bool withCrc, size_t maxPayload, size_t lookAhead) {
+    crc_ = withCrc;
+    maxPayload_ = maxPayload;
+    lookAhead_ = lookAhead;
+    reset();
+}
+
+void FrameParser::reset() {
+    buffer_.clear();
+    dropped_ = 0;
+    parkedScan_ = 0;
+}
+
+bool FrameParser::laterFrame(const uint8_t* frame, size_t available) {
+    // Syncs of frames that can't be judged yet are revisited next time, but only
+    // short ones (within lookAhead); a long one is left to the next real frame.
+    const size_t headerBytes = 2 + 1 + 4;
+    size_t at = parkedScan_ > headerBytes ? parkedScan_ : headerBytes;
+    size_t resume = SIZE_MAX;
+    while (at < available) {
+        const uint8_t* hit = static_cast<const uint8_t*>(std::memchr(frame + at, SYNC_0, available - at));
+        if (hit == nullptr) {
+            at = available;
+            break;
+        }
+        at = hit - frame;
+        if (available - at < headerBytes) {
+            resume = std::min(resume, at);
+            break;
+        }
+        if (frame[at + 1] == SYNC_1) {
+            uint32_t len = readLength(frame + at + 3);
+            if (len <= maxPayload_) {
+                if (available - at >= CRC_OVERHEAD + len) {
+                    if (checkCrc(frame + at + 2, len)) { return true; }
+                }
+                else if (len <= lookAhead_) {
+                    resume = std::min(resume, at);
+                }
+            }
+        }
+        ++at;
+    }
+    parkedScan_ = resume != SIZE_MAX ? resume : at;
+    return false;
+}
+
+bool FrameParser::checkCrc(const uint8_t* hdr, size_t len) {
+    // CRC over [hdr][len][bytes], followed by the little-endian CRC itself.
+    const size_t covered = 1 + 4 + len;
+    uint16_t computed = crc16_ccitt(hdr, covered);
+    uint16_t received = (uint16_t)hdr[covered] | ((uint16_t)hdr[covered + 1] << 8);
+    return computed == received;
+}
+
+void FrameParser::encode(std::string& out, bool withCrc, uint8_t header, const uint8_t* bytes, uint32_t len) {
+    const size_t start = out.size();
+    out.resize(start + (withCrc ? CRC_OVERHEAD : PLAIN_OVERHEAD) + len);
+    uint8_t* p = reinterpret_cast<uint8_t*>(&out[start]);
+
+    if (withCrc) {
+        *p++ = SYNC_0;
+        *p++ = SYNC_1;
+    }
+    uint8_t* covered = p;
+    *p++ = header;
+    *p++ = (uint8_t)(len & 0xFF);          // little-endian
+    *p++ = (uint8_t)((len >> 8) & 0xFF);
+    *p++ = (uint8_t)((len >> 16) & 0xFF);
+    *p++ = (uint8_t)((len >> 24) & 0xFF);
+    if (len > 0) {
+        std::memcpy(p, bytes, len);
+        p += len;
+    }
+
+    if (withCrc) {
+        uint16_t crc = crc16_ccitt(covered, 1 + 4 + len);
+        *p++ = (uint8_t)(crc & 0xFF);
+        *p++ = (uint8_t)((crc >> 8) & 0xFF);
+    }
+}
@@ -0,0 +1,202 @@
+#include "SyncScan.h"
+
+#include <cstring>
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#  define OMNISOC_SYNC_SIMD 1
+#  include <immintrin.h>
+#  define OMNISOC_SSE2_TARGET __attribute__((target("sse2")))
+#  define OMNISOC_AVX2_TARGET __attribute__((target("avx2")))
+#  define OMNISOC_CTZ(x) __builtin_ctz(x)
+#elif defined(_MSC_VER) && (defined(_M_X64) || defined(_M_IX86))
+#  define OMNISOC_SYNC_SIMD 1
+#  include <intrin.h>
+#  include <immintrin.h>
+#  define OMNISOC_SSE2_TARGET
+#  define OMNISOC_AVX2_TARGET
+namespace {
+inline unsigned msvcCtz(unsigned x) { unsigned long i; _BitScanForward(&i, x); return (unsigned)i; }
+}
+#  define OMNISOC_CTZ(x) msvcCtz(x)
+#endif
+
+namespace {
+
+// Scalar scan of data[pos..len), used on its own and for the vector engines' tails.
+size_t scanScalar(const uint8_t* data, size_t pos, size_t len, uint8_t first, uint8_t second,
+                  size_t* out, size_t count, size_t maxOut) {
+    while (count < maxOut && pos + 1 < len) {
+        const uint8_t* hit = static_cast<const uint8_t*>(std::memchr(data + pos, first, len - 1 - pos));
+        if (hit == nullptr) {
+            break;
+        }
+        pos = hit - data;
+        if (data[pos + 1] == second) {
+            out[count++] = pos;
+        }
+        ++pos;
+    }
+    return count;
+}
+
+#ifdef OMNISOC_SYNC_SIMD
+// Each step compares data[i..i+W) against `first` and data[i+1..i+1+W) against
+// `second`; the AND of the two masks has bit k set for a pair at i + k. The
+// shifted load needs i + W < len, the rest goes through the scalar loop.
+OMNISOC_SSE2_TARGET
+size_t scanSse2(const uint8_t* data, size_t len, uint8_t first, uint8_t second,
+                size_t* out, size_t maxOut) {
+    const __m128i f = _mm_set1_epi8((char)first);
+    const __m128i s = _mm_set1_epi8((char)second);
+    size_t count = 0;
+    size_t i = 0;
+    for (; i + 16 < len && count < maxOut; i += 16) {
+        __m128i a = _mm_loadu_si128((const __m128i*)(data + i));
+        __m128i b = _mm_loadu_si128((const __m128i*)(data + i + 1));
+        unsigned mask = (unsigned)_mm_movemask_epi8(
+            _mm_and_si128(_mm_cmpeq_epi8(a, f), _mm_cmpeq_epi8(b, s)));
+        while (mask != 0 && count < maxOut) {
+            out[count++] = i + OMNISOC_CTZ(mask);
+            mask &= mask - 1;
+        }
+    }
+    if (count >= maxOut) {
+        return count;
+    }
+    return scanScalar(data, i, len, first, second, out, count, maxOut);
+}
+
+OMNISOC_AVX2_TARGET
+size_t scanAvx2(const uint8_t* data, size_t len, uint8_t first, uint8_t second,
+                size_t* out, size_t maxOut) {
+    const __m256i f = _mm256_set1_epi8((char)first);
+    const __m256i s = _mm256_set1_epi8((char)second);
+    size_t count = 0;
+    size_t i = 0;
+    for (; i + 32 < len && count < maxOut; i += 32) {
+        __m256i a = _mm256_loadu_si256((const __m256i*)(data + i));
+        __m256i b = _mm256_loadu_si256((const __m256i*)(data + i + 1));
+        unsigned mask = (unsigned)_mm256_movemask_epi8(
+            _mm256_and_si256(_mm256_cmpeq_epi8(a, f), _mm256_cmpeq_epi8(b, s)));
+        while (mask != 0 && count < maxOut) {
+            out[count++] = i + OMNISOC_CTZ(mask);
+            mask &= mask - 1;
+        }
+    }
+    if (count >= maxOut) {
+        return count;
+    }
+    return scanScalar(data, i, len, first, second, out, count, maxOut);
+}
+
+bool cpuHasSse2() {
+#  if defined(__GNUC__)
+    return __builtin_cpu_supports("sse2");
+#  else
+    int info[4];
+    __cpuid(info, 1);
+    return (info[3] & (1 << 26)) != 0;
+#  endif
+}
+
+bool cpuHasAvx2() {
+#  if defined(__GNUC__)
+    return __builtin_cpu_supports("avx2");
+#  else
+    int info[4];
+    __cpuid(info, 1);
+    bool osxsave = (info[2] & (1 << 27)) != 0;
+    bool avx = (info[2] & (1 << 28)) != 0;
+    if (!osxsave || !avx || (_xgetbv(0) & 0x6) != 0x6) {
+        return false;  // OS doesn't save YMM state
+    }
+    __cpuidex(info, 7, 0);
+    return (info[1] & (1 << 5)) != 0;
+#  endif
+}
+#endif
+
+size_t scanPortable(const uint8_t* data, size_t len, uint8_t first, uint8_t second,
+                    size_t* out, size_t maxOut) {
+    return scanScalar(data, 0, len, first, second, out, 0, maxOut);
+}
+
+typedef size_t (*SyncScanFn)(const uint8_t*, size_t, uint8_t, uint8_t, size_t*, size_t);
+
+struct Dispatch {
+    SyncScanEngine engine;
+    SyncScanFn fn;
+
+    Dispatch() {
+#ifdef OMNISOC_SYNC_SIMD
+        if (cpuHasAvx2()) {
+            engine = SyncScanEngine::Avx2;
+            fn = scanAvx2;
+            return;
+        }
+        if (cpuHasSse2()) {
+            engine = SyncScanEngine::Sse2;
+            fn = scanSse2;
+            return;
+        }
+#endif
+        engine = SyncScanEngine::Scalar;
+        fn = scanPortable;
+    }
+};
+
+const Dispatch& dispatch() {
+    static const Dispatch instance;
+    return instance;
+}
+
+} // namespace
+
+size_t sync_scan(const uint8_t* data, size_t len, uint8_t first, uint8_t second,
+                 size_t* out, size_t maxOut) {
+    return dispatch().fn(data, len, first, second, out, maxOut);
+}
+
+bool sync_scan_engine_supported(SyncScanEngine engine) {
+    switch (engine) {
+    case SyncScanEngine::Scalar: return true;
+#ifdef OMNISOC_SYNC_SIMD
+    case SyncScanEngine::Sse2:   return cpuHasSse2();
+    case SyncScanEngine::Avx2:   return cpuHasAvx2();
+#else
+    default:                     return false;
+#endif
+    }
+    return false;
+}
+
+SyncScanEngine sync_scan_active_engine() {
+    return dispatch().engine;
+}
+
+const char* sync_scan_engine_name(SyncScanEngine engine) {
+    switch (engine) {
+    case SyncScanEngine::Scalar: return "scalar";
+    case SyncScanEngine::Sse2:   return "sse2";
+    case SyncScanEngine::Avx2:   return "avx2";
+    }
+    return "unknown";
+}
+
+size_t sync_scan_engine(SyncScanEngine engine, const uint8_t* data, size_t len,
+                        uint8_t first, uint8_t second, size_t* out, size_t maxOut) {
+    switch (engine) {
+    case SyncScanEngine::Scalar: return scanPortable(data, len, first, second, out, maxOut);
+#ifdef OMNISOC_SYNC_SIMD
+    case SyncScanEngine::Sse2:
+        if (cpuHasSse2()) return scanSse2(data, len, first, second, out, maxOut);
+        break;
+    case SyncScanEngine::Avx2:
+        if (cpuHasAvx2()) return scanAvx2(data, len, first, second, out, maxOut);
+        break;
+#else
+    default: break;
+#endif
+    }
+    return sync_scan(data, len, first, second, out, maxOut);
+}
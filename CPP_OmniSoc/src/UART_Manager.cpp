@@ -0,0 +1,191 @@
+#include "UART_Manager.h"
+
+#include <cstring>
+
+UART_Manager::UART_Manager(int _threadCount) {
+    const int threadCount = _threadCount > 0 ? _threadCount : 1;
+    work_.reset(new boost::asio::executor_work_guard<boost::asio::io_context::executor_type>(io_context_.get_executor()));
+    for (int i = 0; i < threadCount; i++) {
+        worker_threads_.emplace_back([this]() { io_context_.run(); });
+    }
+}
+
+UART_Manager::~UART_Manager() {
+    // Every port's read chain has to end before the workers go away.
+    closeAll();
+    work_.reset();
+    for (auto& thread : worker_threads_) {
+        if (thread.joinable()) { thread.join(); }
+    }
+}
+
+int UART_Manager::openPort(const std::string& device, unsigned int baud_rate, int timeoutPeriod_ms,
+                           const PortSetup& setup, bool tx_pacing_enabled) {
+    std::shared_ptr<Port> port = std::make_shared<Port>();
+    port->device = device;
+    port->serial.reset(new UART_Serial(io_context_, device, baud_rate, timeoutPeriod_ms, tx_pacing_enabled));
+    {
+        std::lock_guard<std::mutex> lock(ports_mutex_);
+        port->id = nextPortId++;
+    }
+
+    Port* raw = port.get();
+    port->serial->onMessage([this, raw](uint8_t header, const uint8_t* bytes, uint8_t len) {
+        deliver(*raw, header, bytes, len);
+    });
+    if (setup) {
+        setup(*port->serial);
+    }
+    port->serial->connect();
+    if (!port->serial->isConnected()) {
+        return -1;
+    }
+
+    std::lock_guard<std::mutex> lock(ports_mutex_);
+    ports_[port->id] = port;
+    return port->id;
+}
+
+bool UART_Manager::closePort(int portId) {
+    std::shared_ptr<Port> port;
+    {
+        std::lock_guard<std::mutex> lock(ports_mutex_);
+        auto it = ports_.find(portId);
+        if (it == ports_.end()) { return false; }
+        port = it->second;
+        ports_.erase(it);
+    }
+    // Outside the lock: disconnect() flushes TX and waits for the read chain.
+    port->serial->disconnect();
+    return true;
+}
+
+void UART_Manager::closeAll() {
+    std::map<int, std::shared_ptr<Port>> ports;
+    {
+        std::lock_guard<std::mutex> lock(ports_mutex_);
+        ports.swap(ports_);
+    }
+    for (auto& port : ports) {
+        port.second->serial->disconnect();
+    }
+    // Wake waitForMessages() callers: no more frames are coming from these ports.
+    std::lock_guard<std::mutex> lock(rx_wait_mutex_);
+    closes_++;
+    rx_wait_cv_.notify_all();
+}
+
+std::shared_ptr<UART_Manager::Port> UART_Manager::findPort(int portId) {
+    std::lock_guard<std::mutex> lock(ports_mutex_);
+    auto it = ports_.find(portId);
+    return it == ports_.end() ? nullptr : it->second;
+}
+
+std::shared_ptr<UART_Serial> UART_Manager::getPort(int portId) {
+    std::shared_ptr<Port> port = findPort(portId);
+    if (!port) { return nullptr; }
+    return std::shared_ptr<UART_Serial>(port, port->serial.get());
+}
+
+std::vector<int> UART_Manager::getPortIds() {
+    std::lock_guard<std::mutex> lock(ports_mutex_);
+    std::vector<int> ids;
+    ids.reserve(ports_.size());
+    for (auto& port : ports_) {
+        ids.push_back(port.first);
+    }
+    return ids;
+}
+
+size_t UART_Manager::portCount() {
+    std::lock_guard<std::mutex> lock(ports_mutex_);
+    return ports_.size();
+}
+
+int UART_Manager::sendMessage(int portId, uint8_t header, const uint8_t* bytes, uint8_t len) {
+    std::shared_ptr<Port> port = findPort(portId);
+    if (!port) { return -1; }
+    return port->serial->sendMessage(header, bytes, len);
+}
+
+void UART_Manager::deliver(Port& port, uint8_t header, const uint8_t* bytes, uint8_t len) {
+    port.frames.fetch_add(1, std::memory_order_relaxed);
+    if (messageCallback_) {
+        messageCallback_(port.id, header, bytes, len);
+        return;
+    }
+    // Called from the port's handler, so its current timing is this frame's.
+    const RxTiming& timing = port.serial->currentRxTiming();
+    const bool queued = rxQueue_.emplace([&](Frame& slot) {
+        slot.portId = port.id;
+        slot.frame.header = header;
+        slot.frame.len = len;
+        std::memcpy(slot.frame.bytes, bytes, len);
+        slot.frame.rxTime = timing.parsed;
+        slot.frame.timing = timing;
+    });
+    if (!queued) {
+        dropped_.fetch_add(1);
+        return;
+    }
+    // Pairs with the fence in waitForMessages(): either it sees the frame or we see it waiting.
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    if (rxWaiters_.load() > 0) {
+        std::lock_guard<std::mutex> lock(rx_wait_mutex_);
+        rx_wait_cv_.notify_all();
+    }
+}
+
+int UART_Manager::receiveMessage(Frame& out) {
+    std::lock_guard<std::mutex> lock(rx_mutex_);
+    if (!rxQueue_.pop(out)) {
+        return -1;
+    }
+    out.frame.timing.dispatched = std::chrono::steady_clock::now();
+    return 1;
+}
+
+size_t UART_Manager::receiveMessages(Frame* frames, size_t maxFrames) {
+    std::lock_guard<std::mutex> lock(rx_mutex_);
+    size_t count = 0;
+    while (count < maxFrames && rxQueue_.pop(frames[count])) {
+        ++count;
+    }
+    if (count > 0) {
+        const auto now = std::chrono::steady_clock::now();
+        for (size_t i = 0; i < count; ++i) {
+            frames[i].frame.timing.dispatched = now;
+        }
+    }
+    return count;
+}
+
+bool UART_Manager::waitForMessages(int timeout_ms) {
+    std::unique_lock<std::mutex> lock(rx_wait_mutex_);
+    rxWaiters_++;
+    // Pairs with the fence in deliver().
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+
+    const uint64_t closes = closes_;
+    auto ready = [this, closes]() { return !rxQueue_.empty() || closes_ != closes; };
+    if (timeout_ms < 0) {
+        rx_wait_cv_.wait(lock, ready);
+    } else {
+        rx_wait_cv_.wait_for(lock, std::chrono::milliseconds(timeout_ms), ready);
+    }
+    rxWaiters_--;
+    return !rxQueue_.empty();
+}
+
+bool UART_Manager::getPortStats(int portId, PortStats& out) {
+    std::shared_ptr<Port> port = findPort(portId);
+    if (!port) { return false; }
+    out.device = port->device;
+    out.connected = port->serial->isConnected();
+    out.framesReceived = port->frames.load();
+    out.droppedBytes = port->serial->getDroppedBytesCount();
+    out.droppedFrames = port->serial->getDroppedFramesCount();
+    out.outgoingDepth = port->serial->getOutgoingQueueDepth();
+    out.droppedOutgoing = port->serial->getDroppedOutgoingCount();
+    return true;
+}
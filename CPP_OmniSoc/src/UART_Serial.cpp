@@ -1,5 +1,9 @@
 #include "UART_Serial.h"
+#include "CRC16.h"
+#include "SerialBaud.h"
+#include "SyncScan.h"
 
+#include <algorithm>
 #include <cmath>
 #include <cstring>
 
@@ -7,11 +11,56 @@
 #  include <termios.h>
 #  include <unistd.h>
 #endif
+#if defined(__linux__)
+#  include <linux/serial.h>
+#  include <sys/ioctl.h>
+#endif
+
+namespace {
+
+// Steps through a bundle payload: repeated [hdr:1][len:1][bytes:len]. Returns
+// false at the end, or if the next sub-message would run past the payload.
+bool nextBundled(const uint8_t* payload, size_t size, size_t& pos,
+                 uint8_t& header, const uint8_t*& bytes, uint8_t& len) {
+    if (pos + 2 > size) {
+        return false;
+    }
+    header = payload[pos];
+    len = payload[pos + 1];
+    if (pos + 2 + len > size) {
+        return false;
+    }
+    bytes = payload + pos + 2;
+    pos += 2 + len;
+    return true;
+}
+
+} // namespace
 
 UART_Serial::UART_Serial(const std::string& port, unsigned int baud_rate, int timeoutPeriod_ms,
                          bool tx_pacing_enabled)
-    : serial_(io_context_), port_(port), baud_rate_(baud_rate), timeoutPeriod_ms_(timeoutPeriod_ms),
-      running_(false), tx_pacing_enabled_(tx_pacing_enabled) {}
+    : UART_Serial(nullptr, port, baud_rate, timeoutPeriod_ms, tx_pacing_enabled) {}
+
+UART_Serial::UART_Serial(boost::asio::io_context& context, const std::string& port, unsigned int baud_rate,
+                         int timeoutPeriod_ms, bool tx_pacing_enabled)
+    : UART_Serial(&context, port, baud_rate, timeoutPeriod_ms, tx_pacing_enabled) {}
+
+UART_Serial::UART_Serial(boost::asio::io_context* shared, const std::string& port, unsigned int baud_rate,
+                         int timeoutPeriod_ms, bool tx_pacing_enabled)
+    : ownContext_(shared ? nullptr : new boost::asio::io_context), io_context_(shared ? *shared : *ownContext_),
+      serial_(boost::asio::make_strand(io_context_)), read_timer_(serial_.get_executor()),
+      port_(port), baud_rate_(baud_rate), timeoutPeriod_ms_(timeoutPeriod_ms),
+      rx_ring_(new ByteRing(DEFAULT_RX_BUFFER)), rxMarks_(new SPSCQueue<ArrivalMark>(DEFAULT_RX_BUFFER)), running_(false), tx_timer_(boost::asio::make_strand(io_context_)),
+      tx_pacing_enabled_(tx_pacing_enabled) {
+    for (TxPriority& priority : headerPriority_) {
+        priority = TxPriority::Normal;
+    }
+    for (std::atomic<size_t>& count : mailboxPerLane_) {
+        count = 0;
+    }
+    rxFragments_.setLimits(4, 64 * 1024, timeoutPeriod_ms_);
+    rxFragments_.onMessage([this](uint8_t header, std::vector<uint8_t>& message) { completeLarge(header, message); });
+}
 
 UART_Serial::~UART_Serial() {
     disconnect();
@@ -24,16 +73,21 @@ void UART_Serial::connect() {
         std::cerr << "Error opening serial port: " << ec.message() << std::endl;
         return;
     }
-    serial_.set_option(boost::asio::serial_port_base::baud_rate(baud_rate_));
+    // Standard rates only; anything else fails here and is retried below.
+    boost::system::error_code baudEc;
+    serial_.set_option(boost::asio::serial_port_base::baud_rate(baud_rate_), baudEc);
     serial_.set_option(boost::asio::serial_port_base::character_size(8));
     serial_.set_option(boost::asio::serial_port_base::parity(boost::asio::serial_port_base::parity::none));
     serial_.set_option(boost::asio::serial_port_base::stop_bits(boost::asio::serial_port_base::stop_bits::one));
-    serial_.set_option(boost::asio::serial_port_base::flow_control(boost::asio::serial_port_base::flow_control::none));
+    serial_.set_option(boost::asio::serial_port_base::flow_control(flowControl_ == FlowControl::RtsCts
+        ? boost::asio::serial_port_base::flow_control::hardware
+        : boost::asio::serial_port_base::flow_control::none));
+    actualBaud_ = baud_rate_;
 
 #if defined(__unix__) || defined(__APPLE__)
     // Put the TTY in raw mode AND configure the kernel-side read timeout.
     //
-    // Boost ASIO's flow_control::none only clears hardware RTS/CTS; it leaves
+    // Boost ASIO's flow_control only sets or clears hardware RTS/CTS; it leaves
     // ICANON (line buffering) and IXON/IXOFF (software flow control) at the
     // kernel default, which is typically ON. With IXON on, binary bytes that
     // happen to equal XOFF (0x13) silently stall writes until an XON (0x11)
@@ -42,22 +96,50 @@ void UART_Serial::connect() {
     // arrives. cfmakeraw() disables both plus signal chars, echo, and output
     // post-processing.
     //
-    // VMIN=0, VTIME=1 (100 ms) makes read() return within 100 ms with
-    // whatever bytes are available (or zero on idle). This is the kernel-side
-    // shutdown bound: the read thread observes running_=false within 100 ms
-    // of disconnect() instead of blocking forever on an idle FD. Must be set
-    // AFTER cfmakeraw() because cfmakeraw() resets VMIN=1, VTIME=0.
+    // Reads are asynchronous on a non-blocking FD, so VMIN/VTIME no longer
+    // bound a blocking read(); they only decide when the FD polls readable.
+    // Batched keeps VMIN=0, VTIME=1 (readable as soon as a byte is in).
+    // LowLatency uses VMIN=1, VTIME=0 — also readable on the first byte, with
+    // no inter-byte timer in the line discipline. Must be set AFTER
+    // cfmakeraw() because cfmakeraw() resets VMIN=1, VTIME=0.
     int fd = serial_.native_handle();
     termios tio{};
     if (tcgetattr(fd, &tio) == 0) {
         cfmakeraw(&tio);
-        tio.c_cc[VMIN]  = 0;
-        tio.c_cc[VTIME] = 1;
+        const bool lowLatency = readProfile_ == ReadProfile::LowLatency;
+        tio.c_cc[VMIN]  = lowLatency ? 1 : 0;
+        tio.c_cc[VTIME] = lowLatency ? 0 : 1;
         tcsetattr(fd, TCSANOW, &tio);
     }
+    if (readProfile_ == ReadProfile::LowLatency) {
+        configureLowLatency(fd);
+    }
+    // Non-standard rates through termios2/BOTHER. After the tcsetattr() above, which
+    // rewrites the speed bits from glibc's view of the port.
+    if (baudEc && serial_set_custom_baud(fd, baud_rate_, &actualBaud_)) {
+        baudEc.clear();
+    }
 #endif
+#if defined(_WIN32)
+    if (driverRxBytes_ > 0 || driverTxBytes_ > 0) {
+        SetupComm(serial_.native_handle(), (DWORD)(driverRxBytes_ > 0 ? driverRxBytes_ : 4096),
+                  (DWORD)(driverTxBytes_ > 0 ? driverTxBytes_ : 4096));
+    }
+#endif
+    if (baudEc) {
+        std::cerr << "Error setting baud rate " << baud_rate_ << ": " << baudEc.message() << std::endl;
+        boost::system::error_code closeEc;
+        serial_.close(closeEc);
+        return;
+    }
+    if (actualBaud_ == 0) {
+        actualBaud_ = baud_rate_;
+    }
+    if (actualBaud_ * 100 < baud_rate_ * 97 || actualBaud_ * 100 > baud_rate_ * 103) {
+        std::cerr << "Serial port runs at " << actualBaud_ << " baud, not " << baud_rate_ << std::endl;
+    }
 
-    byteSpacingTime_us = static_cast<long>(ceil(10000000.0 / baud_rate_));
+    byteSpacingTime_ns = static_cast<long>(ceil(1e10 / actualBaud_));
     lastTimeoutClock = std::chrono::steady_clock::now();
     timeoutFlag = false;
 
@@ -65,18 +147,33 @@ void UART_Serial::connect() {
 }
 
 void UART_Serial::disconnect() {
+    // Let frames already accepted by sendMessage() reach the wire first.
+    if (txRunning_) {
+        flushOutgoing(timeoutPeriod_ms_);
+    }
     timeoutFlag = true;
     running_ = false;
+    {
+        std::lock_guard<std::mutex> lock(rx_wait_mutex_);
+        rx_wait_cv_.notify_all();
+    }
 
-    // VTIME bounds each kernel read at 100 ms, so the read thread observes
-    // running_=false and exits cleanly. Join first, then close — no need to
-    // race-close the FD to wake a blocked reader anymore.
+    // stopWorkThreads() stops io_context_, which wakes the read thread out of
+    // the reactor even on an idle line (on a shared context: ends the read chain).
+    // Join first, then close.
     stopWorkThreads();
 
     boost::system::error_code ec;
+    read_timer_.cancel(ec);
     if (serial_.is_open()) {
         serial_.close(ec);
     }
+    // Run the aborted read/timer handlers now (they see running_ == false) so
+    // none is left queued to fire after a reconnect.
+    if (ownContext_) {
+        io_context_.restart();
+        io_context_.poll();
+    }
 }
 
 bool UART_Serial::isConnected() {
@@ -84,14 +181,60 @@ bool UART_Serial::isConnected() {
 }
 
 size_t UART_Serial::available() {
+    return rx_ring_->size();
+}
+
+bool UART_Serial::setReceiveBufferSize(size_t bytes) {
+    if (running_) {
+        return false;
+    }
     std::lock_guard<std::mutex> lock(buffer_mutex_);
-    return buffer_.size();
+    rx_ring_.reset(new ByteRing(bytes < 2 * MAX_FRAME_SIZE ? 2 * MAX_FRAME_SIZE : bytes));
+    rxMarks_.reset(new SPSCQueue<ArrivalMark>(rx_ring_->capacity()));
+    rxSeen_ = 0;
+    rxHeld_ = 0;
+    rxBundleLen_ = 0;
+    rxBundlePos_ = 0;
+    resetSyncScan();
+    resetArrivalMarks();   // positions start over with the new ring
+    return true;
+}
+
+bool UART_Serial::setDriverBufferSizes(size_t rxBytes, size_t txBytes) {
+    if (running_) {
+        return false;
+    }
+#if !defined(_WIN32)
+    if (rxBytes > 0 && !setReceiveBufferSize(rxBytes)) {
+        return false;
+    }
+#endif
+    driverRxBytes_ = rxBytes;
+    driverTxBytes_ = txBytes;
+    return true;
 }
 
 void UART_Serial::flushIncomingSerial() {
     std::lock_guard<std::mutex> lock(buffer_mutex_);
-    buffer_.clear();
-    scan_pos_ = 0;
+    // Consumer-side drop of everything visible now; the read thread keeps appending.
+    size_t seen = rx_ring_->written();
+    consumeRx(rx_ring_->size() - rxHeld_);
+    releaseRx();
+    rxBundleLen_ = 0;
+    rxBundlePos_ = 0;
+    rxFragments_.reset();
+    rxSeen_ = seen;
+    {
+        std::lock_guard<std::mutex> largeLock(large_mutex_);
+        largeQueue_.clear();
+        largeQueued_ = 0;
+    }
+    if (dispatching_) {
+        std::lock_guard<std::mutex> framesLock(rx_frames_mutex_);
+        Frame frame;
+        while (rxFrames_.pop(frame)) {
+        }
+    }
 #if defined(__unix__) || defined(__APPLE__)
     if (serial_.is_open()) {
         tcflush(serial_.native_handle(), TCIFLUSH);
@@ -100,57 +243,808 @@ void UART_Serial::flushIncomingSerial() {
 }
 
 int UART_Serial::sendMessage(uint8_t header, const uint8_t* bytes, uint8_t len) {
-    if (len > MAX_PAYLOAD) {
+    if (len > MAX_PAYLOAD || header == BUNDLE_HEADER || header == FRAGMENT_HEADER ||
+        header == CREDIT_HEADER || !txRunning_) {
         return -1;
     }
 
-    // Serialize concurrent senders + apply TX pacing. Boost ASIO does not
-    // synchronize concurrent writes on a serial_port; we have to.
-    std::lock_guard<std::mutex> tx_lock(send_mutex_);
+    // The frame is encoded here, on the caller's thread, straight into its queue
+    // slot or mailbox; the TX scheduler thread only picks, packs and writes.
+    // Nothing here waits on the wire unless the Block policy is selected and the
+    // header's lane is full.
+    if (headerLatest_[header]) {
+        postLatest(header, bytes, len);
+        wakeTx();
+        return 1;
+    }
+    return queueFrame(txLanes_[(int)headerPriority_[header]], header, bytes, len,
+                      txBackpressure_.policy == BackpressureOptions::Policy::Block);
+}
 
-    if (tx_pacing_enabled_ && byteSpacingTime_us > 0) {
-        auto now = std::chrono::steady_clock::now();
-        if (now < earliest_next_send_) {
-            std::this_thread::sleep_until(earliest_next_send_);
+int UART_Serial::sendLargeMessage(uint8_t header, const uint8_t* bytes, size_t len) {
+    if (len > MAX_LARGE_PAYLOAD || header == BUNDLE_HEADER || header == FRAGMENT_HEADER ||
+        header == CREDIT_HEADER || !txRunning_) {
+        return -1;
+    }
+    // Fragments go out in order on the header's lane. Concurrent large messages may
+    // interleave; msgId keeps them apart at the receiver.
+    TxLane& lane = txLanes_[(int)headerPriority_[header]];
+    const uint8_t msgId = txMessageId_.fetch_add(1);
+    const size_t count = fragment_count(len, MAX_PAYLOAD);
+    uint8_t payload[MAX_PAYLOAD];
+    for (size_t i = 0; i < count; ++i) {
+        uint8_t n = (uint8_t)fragment_encode(header, msgId, i, bytes, len, MAX_PAYLOAD, payload);
+        int rc = queueFrame(lane, FRAGMENT_HEADER, payload, n, true);
+        if (rc != 1) {
+            // The fragments already queued still go out; the receiver drops the
+            // incomplete message when it times out.
+            return rc;
         }
     }
+    return 1;
+}
+
+int UART_Serial::queueFrame(TxLane& lane, uint8_t header, const uint8_t* bytes, uint8_t len, bool block) {
+    const size_t size = FRAME_OVERHEAD + len;
+    int rc = reserveTx(lane, size, block);
+    if (rc != 1) {
+        return rc;
+    }
+    bool queued = lane.queue.emplace([&](TxFrame& frame) { encodeFrame(frame, header, bytes, len); });
+    if (!queued) {
+        // Can't happen while the high-water mark is at most the queue capacity.
+        lane.frames--;
+        lane.bytes -= size;
+        txDropped_++;
+        return -2;
+    }
+    wakeTx();
+    return 1;
+}
+
+void UART_Serial::wakeTx() {
+    // Pairs with the fence in waitForTx(): either the scheduler sees the frame or we see it waiting.
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    if (!txSchedulerWaiting_.load()) {
+        return;
+    }
+    if (ownContext_) {
+        std::lock_guard<std::mutex> lock(tx_mutex_);
+        tx_cv_.notify_one();
+    } else if (!txKickPosted_.exchange(true)) {
+        // One kick in flight at a time; it clears the flag before it looks, so a
+        // wake that finds it set is covered by that kick.
+        txKicks_++;
+        boost::asio::post(tx_timer_.get_executor(), [this]() {
+            txKickPosted_ = false;
+            kickTx();
+            if (--txKicks_ == 0 && !txRunning_) {
+                std::lock_guard<std::mutex> lock(tx_mutex_);
+                tx_cv_.notify_all();
+            }
+        });
+    }
+}
 
-    int messageSize = FRAME_OVERHEAD + len;
-    std::vector<uint8_t> message(messageSize);
+int UART_Serial::setHeaderQos(uint8_t header, TxPriority priority, bool latestValue) {
+    if (header == BUNDLE_HEADER || header == FRAGMENT_HEADER || header == RELIABLE_HEADER ||
+        header == CREDIT_HEADER) {
+        return -1;
+    }
+    headerPriority_[header] = priority;
+    headerLatest_[header] = latestValue;
+    return 1;
+}
 
-    // Sync bytes (advisory pre-filter for the receiver — not in the CRC).
-    message[0] = SYNC_0;
-    message[1] = SYNC_1;
-    message[SYNC_SIZE] = header;
-    message[SYNC_SIZE + HEADER_SIZE] = len;
+void UART_Serial::encodeFrame(TxFrame& frame, uint8_t header, const uint8_t* bytes, uint8_t len) {
+    const size_t size = FRAME_OVERHEAD + len;
+    frame.size = (uint8_t)size;
+    frame.latest = false;
+    frame.bytes[0] = SYNC_0;   // Sync bytes (advisory pre-filter for the receiver — not in the CRC).
+    frame.bytes[1] = SYNC_1;
+    frame.bytes[SYNC_SIZE] = header;
+    frame.bytes[SYNC_SIZE + HEADER_SIZE] = len;
     if (len > 0) {
-        std::memcpy(&message[SYNC_SIZE + HEADER_SIZE + LEN_SIZE], bytes, len);
+        std::memcpy(&frame.bytes[PAYLOAD_OFFSET], bytes, len);
     }
+    // CRC-16 over [hdr][len][bytes] — sync excluded. Little-endian on the wire.
+    uint16_t crc = crc16_ccitt(&frame.bytes[SYNC_SIZE], HEADER_SIZE + LEN_SIZE + len);
+    frame.bytes[size - 2] = (uint8_t)(crc & 0xFF);
+    frame.bytes[size - 1] = (uint8_t)((crc >> 8) & 0xFF);
+}
 
-    // CRC-16 over [hdr][len][bytes] — sync excluded.
-    uint16_t crc = crc16_ccitt(&message[SYNC_SIZE], HEADER_SIZE + LEN_SIZE + len);
-    message[messageSize - 2] = (uint8_t)(crc & 0xFF);          // little-endian
-    message[messageSize - 1] = (uint8_t)((crc >> 8) & 0xFF);
+void UART_Serial::postLatest(uint8_t header, const uint8_t* bytes, uint8_t len) {
+    // One slot per header: a newer value overwrites one that hasn't gone out yet,
+    // so stale values never take link time.
+    TxFrame frame;
+    encodeFrame(frame, header, bytes, len);
+    frame.latest = true;
+    std::lock_guard<std::mutex> lock(mailbox_mutex_);
+    storeMailbox(frame);
+}
 
-    boost::system::error_code ec;
-    boost::asio::write(serial_, boost::asio::buffer(message), ec);
-    if (ec) {
+void UART_Serial::storeMailbox(const TxFrame& frame) {
+    const uint8_t header = frame.bytes[SYNC_SIZE];
+    if (mailboxFull_[header]) {
+        txCoalesced_++;
+    } else {
+        mailboxFull_[header] = true;
+        mailboxLane_[header] = (uint8_t)headerPriority_[header];
+        mailboxPerLane_[mailboxLane_[header]]++;
+        mailboxCount_++;
+    }
+    mailbox_[header] = frame;
+}
+
+bool UART_Serial::takeMailbox(int lane, TxFrame& out) {
+    std::lock_guard<std::mutex> lock(mailbox_mutex_);
+    if (mailboxPerLane_[lane] == 0) {
+        return false;
+    }
+    // Round-robin over the lane's headers so one busy header can't starve the rest.
+    for (int i = 0; i < 256; ++i) {
+        const uint8_t header = (uint8_t)(mailboxCursor_ + i);
+        if (mailboxFull_[header] && mailboxLane_[header] == lane) {
+            out = mailbox_[header];
+            mailboxFull_[header] = false;
+            mailboxPerLane_[lane]--;
+            mailboxCount_--;
+            mailboxCursor_ = (uint8_t)(header + 1);
+            return true;
+        }
+    }
+    return false;
+}
+
+int UART_Serial::reserveTx(TxLane& lane, size_t size, bool block) {
+    // Claims a queue slot up front (fetch_add, rolled back if over the limit) so
+    // concurrent senders can't overshoot the high-water mark or the queue itself.
+    // Limits are per lane: a telemetry backlog never blocks an urgent header.
+    const size_t capacity = lane.queue.capacity();
+    while (true) {
+        const size_t frames = lane.frames.fetch_add(1);
+        if (!txBackpressure_.wouldExceed(lane.bytes, frames, size, capacity)) {
+            lane.bytes += size;
+            return 1;
+        }
+        lane.frames--;
+
+        if (!block) {
+            if (txBackpressure_.policy == BackpressureOptions::Policy::DropOldest && dropOldestTx(lane)) {
+                continue;
+            }
+            if (txBackpressure_.policy != BackpressureOptions::Policy::Fail) {
+                txDropped_++;
+            }
+            return -2;
+        }
+
+        std::unique_lock<std::mutex> lock(tx_mutex_);
+        txSpaceWaiters_++;
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        auto ready = [&]() {
+            return !txRunning_ || txBackpressure_.drained(lane.bytes, lane.frames, capacity);
+        };
+        bool ok;
+        if (txBackpressure_.blockTimeout_ms < 0) {
+            tx_space_cv_.wait(lock, ready);
+            ok = true;
+        } else {
+            ok = tx_space_cv_.wait_for(lock, std::chrono::milliseconds(txBackpressure_.blockTimeout_ms), ready);
+        }
+        txSpaceWaiters_--;
+        if (!ok || !txRunning_) {
+            return -3;
+        }
+    }
+}
+
+bool UART_Serial::dropOldestTx(TxLane& lane) {
+    TxFrame frame;
+    {
+        std::lock_guard<std::mutex> lock(lane.popMutex);
+        if (!lane.queue.pop(frame)) {
+            return false;   // nothing evictable: the rest is reserved or being written
+        }
+    }
+    lane.frames--;
+    lane.bytes -= frame.size;
+    txDropped_++;
+    return true;
+}
+
+size_t UART_Serial::getOutgoingQueueDepth() const {
+    size_t depth = mailboxCount_.load();
+    for (const TxLane& lane : txLanes_) {
+        depth += lane.frames.load();
+    }
+    return depth;
+}
+
+bool UART_Serial::flushOutgoing(int timeout_ms) {
+    auto idle = [this]() { return !txRunning_ || (getOutgoingQueueDepth() == 0 && !txBusy_); };
+    std::unique_lock<std::mutex> lock(tx_mutex_);
+    txSpaceWaiters_++;
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    bool ok;
+    if (timeout_ms < 0) {
+        tx_space_cv_.wait(lock, idle);
+        ok = true;
+    } else {
+        ok = tx_space_cv_.wait_for(lock, std::chrono::milliseconds(timeout_ms), idle);
+    }
+    txSpaceWaiters_--;
+    return ok && getOutgoingQueueDepth() == 0;
+}
+
+int UART_Serial::popTx(TxFrame& out) {
+    // Strict priority: the most urgent lane with anything pending wins. Within a
+    // lane a put-back frame goes first, then latest-value mailboxes, then FIFO.
+    for (int lane = 0; lane < TX_LANES; ++lane) {
+        if (txCarryFull_[lane]) {
+            out = txCarry_[lane];
+            txCarryFull_[lane] = false;
+            return lane;
+        }
+        if (mailboxPerLane_[lane] > 0 && takeMailbox(lane, out)) {
+            return lane;
+        }
+        std::lock_guard<std::mutex> lock(txLanes_[lane].popMutex);
+        if (txLanes_[lane].queue.pop(out)) {
+            return lane;
+        }
+    }
+    return -1;
+}
+
+void UART_Serial::putBackTx(const TxFrame& frame, int lane) {
+    // A frame that didn't fit this write. Latest-value frames go back to their
+    // mailbox unless a newer value arrived meanwhile (then this one is stale).
+    if (frame.latest) {
+        std::lock_guard<std::mutex> lock(mailbox_mutex_);
+        if (mailboxFull_[frame.bytes[SYNC_SIZE]]) {
+            txCoalesced_++;
+        } else {
+            storeMailbox(frame);
+        }
+        return;
+    }
+    txCarry_[lane] = frame;
+    txCarryFull_[lane] = true;
+}
+
+void UART_Serial::packedTx(const TxFrame& frame, int lane) {
+    if (!frame.latest) {
+        txLanes_[lane].frames--;
+        txLanes_[lane].bytes -= frame.size;
+    }
+}
+
+UART_Serial::TxStep UART_Serial::nextTxStep() {
+    // Single pacing clock: txWireFree_ is when the bytes written so far will have
+    // left the UART at the configured baud rate. A write may run ahead of it by
+    // at most txBurstBytes_, so a slow receiver's HW buffer (Arduino: 64 B) sees
+    // bytes no faster than the baud rate can deliver them. Keeping writes that
+    // small also bounds head-of-line blocking: an urgent frame waits for at most
+    // one burst, then is picked ahead of everything else.
+    // With RTS/CTS the peer's handshake paces the line instead, and with credit
+    // flow control the peer's grants do, once the first one has arrived.
+    const bool pacing = tx_pacing_enabled_ && flowControl_ == FlowControl::None && byteSpacingTime_ns > 0;
+    const long burst = (long)txBurstBytes_;
+    TxStep step;
+    TxFrame frame;
+
+    while (true) {
+        if (!txRunning_) {
+            // Disconnecting: whatever flushOutgoing() didn't get out is dropped.
+            int lane;
+            while ((lane = popTx(frame)) >= 0) {
+                packedTx(frame, lane);
+            }
+            txBusy_ = false;
+            notifyTxSpace();
+            step.kind = TxStep::Stop;
+            return step;
+        }
+        if (creditEnabled_) {
+            advertiseCredit();
+        }
+        txBusy_ = true;
+        const bool morePending = hasPendingTx();
+        int lane = popTx(frame);
+        if (lane < 0) {
+            step.kind = TxStep::Idle;
+            return step;
+        }
+
+        // Bundling window: a lone small frame on an idle queue waits briefly for
+        // others to share its frame. Urgent frames never wait.
+        if (txBundling_ && txBundleWindow_us_ > 0 && !txWindowWaited_ && !morePending &&
+            lane != (int)TxPriority::Urgent && bundleable(frame)) {
+            putBackTx(frame, lane);
+            txWindowWaited_ = true;
+            step.kind = TxStep::Bundle;
+            return step;
+        }
+
+        size_t budget = TX_BATCH_BYTES;
+        auto now = std::chrono::steady_clock::now();
+        if (creditActive_) {
+            const uint32_t grants = creditGrants_.load();
+            const uint32_t adverts = creditAdverts_.load();
+            long allowed = creditAllowance();
+            if (allowed < (long)frame.size) {
+                putBackTx(frame, lane);
+                if (!takeCreditFrame(frame)) {
+                    creditStalls_++;
+                    const auto granted = std::chrono::steady_clock::time_point(
+                        std::chrono::nanoseconds(peerCreditTime_ns_.load()));
+                    if (now - granted > std::chrono::milliseconds((int)CREDIT_TIMEOUT_MS)) {
+                        // The peer stopped granting: back to pacing until it resumes.
+                        creditActive_ = false;
+                        continue;
+                    }
+                    step.kind = TxStep::Credit;
+                    step.grants = grants;
+                    step.adverts = adverts;
+                    return step;
+                }
+                // Out of credit, but our own grant goes out anyway: the peer may be
+                // waiting for it just the same.
+                lane = (int)TxPriority::Urgent;
+                allowed = frame.size;
+            }
+            budget = allowed < (long)TX_BATCH_BYTES ? (size_t)allowed : TX_BATCH_BYTES;
+        } else if (pacing) {
+            long backlog = txWireFree_ > now
+                ? (long)(std::chrono::duration_cast<std::chrono::nanoseconds>(txWireFree_ - now).count() / byteSpacingTime_ns)
+                : 0;
+            long allowed = burst - backlog;
+            // With bundling, a backlog of small frames is worth holding until a
+            // full bundle's worth of room opens, so each write carries one.
+            long need = (long)frame.size;
+            if (txBundling_ && lane != (int)TxPriority::Urgent && bundleable(frame)) {
+                need = std::max(need, std::min(burst, (long)MAX_FRAME_SIZE));
+            }
+            if (backlog > 0 && allowed < need) {
+                // Not enough room ahead of the baud clock: sleep until there is,
+                // then pick again in case something more urgent arrived.
+                putBackTx(frame, lane);
+                long headroom = burst > need ? burst - need : 0;
+                step.kind = TxStep::Sleep;
+                step.until = txWireFree_ - std::chrono::nanoseconds(headroom * byteSpacingTime_ns);
+                return step;
+            }
+            budget = allowed > (long)frame.size ? (size_t)allowed : frame.size;
+            if (budget > TX_BATCH_BYTES) {
+                budget = TX_BATCH_BYTES;
+            }
+        }
+
+        // Pack frames back to back, most urgent first, up to the budget; a frame
+        // that doesn't fit is put back for the next write.
+        TxPacker packer(*this, budget);
+        packer.add(frame);
+        packedTx(frame, lane);
+        while (!packer.full() && (lane = popTx(frame)) >= 0) {
+            if (!packer.add(frame)) {
+                putBackTx(frame, lane);
+                break;
+            }
+            packedTx(frame, lane);
+        }
+        const size_t n = packer.finish();
+        txWindowWaited_ = false;
+        if (pacing) {
+            txWireFree_ = (txWireFree_ > now ? txWireFree_ : now) + std::chrono::nanoseconds((long)n * byteSpacingTime_ns);
+        }
+        step.kind = TxStep::Write;
+        step.bytes = n;
+        step.checkDriver = (!pacing || creditActive_) && driverTxBytes_ > 0;
+        return step;
+    }
+}
+
+void UART_Serial::finishTxWrite(size_t bytes, const boost::system::error_code& ec) {
+    if (ec && ec != boost::asio::error::operation_aborted) {
         std::cerr << "Error writing to serial port: " << ec.message() << std::endl;
-        return -1;
     }
+    txSentTotal_ += (uint32_t)bytes;
+    notifyTxSpace();
+}
 
-    if (tx_pacing_enabled_ && byteSpacingTime_us > 0) {
-        // Reserve wire time = messageSize * byteSpacingTime_us for this frame.
-        // Next sendMessage waits at least this long, so consecutive frames
-        // arrive at the receiver no faster than the baud rate can deliver
-        // them — receiver HW UART buffer fills at the baud rate ≤ its drain
-        // rate, never overflowing.
-        long wire_time_us = (long)messageSize * byteSpacingTime_us;
-        earliest_next_send_ = std::chrono::steady_clock::now()
-                            + std::chrono::microseconds(wire_time_us);
+void UART_Serial::txScheduler() {
+    // Own context: carry out each step on this thread, blocking where it waits.
+    while (true) {
+        const TxStep step = nextTxStep();
+        switch (step.kind) {
+        case TxStep::Stop:
+            return;
+        case TxStep::Idle:
+            waitForTx();
+            break;
+        case TxStep::Sleep:
+            std::this_thread::sleep_until(step.until);
+            break;
+        case TxStep::Credit:
+            waitForCredit(step.grants, step.adverts);
+            break;
+        case TxStep::Bundle:
+            waitBundleWindow();
+            break;
+        case TxStep::Write: {
+            if (step.checkDriver) {
+                waitDriverRoom(step.bytes);
+            }
+            boost::system::error_code ec;
+            boost::asio::write(serial_, boost::asio::buffer(txBatch_, step.bytes), ec);
+            finishTxWrite(step.bytes, ec);
+            break;
+        }
+        }
     }
+}
 
-    return 1;
+void UART_Serial::pumpTx() {
+    // Shared context: run steps until one has to wait, then park on tx_timer_ (or
+    // the write in flight) and return the worker to the loop. The waits end on
+    // the same conditions as txScheduler()'s: kickTx() cancels the timer early.
+    while (true) {
+        txParked_ = nextTxStep();
+        switch (txParked_.kind) {
+        case TxStep::Stop: {
+            txSchedulerWaiting_ = false;
+            std::lock_guard<std::mutex> lock(tx_mutex_);
+            txPumpActive_ = false;
+            tx_cv_.notify_all();
+            return;
+        }
+        case TxStep::Write:
+            writeTx();
+            return;
+        case TxStep::Sleep:
+            parkTx(txParked_.until);
+            return;
+        default:
+            break;
+        }
+        // Idle, Credit, Bundle: producers wake us through wakeTx() from here on.
+        // Pairs with the fence in wakeTx(), as in waitForTx().
+        txSchedulerWaiting_ = true;
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        auto now = std::chrono::steady_clock::now();
+        if (txParked_.kind == TxStep::Idle) {
+            txBusy_ = false;
+            notifyTxSpace();   // idle: wake flushOutgoing()
+            if (hasPendingTx() || !txRunning_) {
+                txSchedulerWaiting_ = false;
+                continue;
+            }
+            parkTx(creditEnabled_ ? now + std::chrono::milliseconds((int)CREDIT_REFRESH_MS)
+                                  : std::chrono::steady_clock::time_point::max());
+        } else if (txParked_.kind == TxStep::Credit) {
+            parkTx(now + std::chrono::milliseconds((int)CREDIT_REFRESH_MS));
+        } else {
+            parkTx(now + std::chrono::microseconds(txBundleWindow_us_));
+        }
+        // Anything that arrived before the flag was up is caught here.
+        kickTx();
+        return;
+    }
+}
+
+void UART_Serial::parkTx(std::chrono::steady_clock::time_point until) {
+    tx_timer_.expires_at(until);
+    tx_timer_.async_wait([this](const boost::system::error_code&) {
+        txSchedulerWaiting_ = false;
+        pumpTx();
+    });
+}
+
+void UART_Serial::kickTx() {
+    // Ends the parked wait if what it waits for has happened.
+    if (!txSchedulerWaiting_) {
+        return;
+    }
+    bool ready = !txRunning_;
+    switch (txParked_.kind) {
+    case TxStep::Idle:
+        ready = ready || hasPendingTx();
+        break;
+    case TxStep::Credit:
+        ready = ready || creditGrants_.load() != txParked_.grants || creditAdverts_.load() != txParked_.adverts;
+        break;
+    case TxStep::Bundle:
+        ready = ready || !txLanes_[(int)TxPriority::Urgent].queue.empty();
+        break;
+    default:
+        break;
+    }
+    if (ready) {
+        tx_timer_.cancel();
+    }
+}
+
+void UART_Serial::writeTx() {
+    if (txParked_.checkDriver && txRunning_) {
+        const long wait_ns = driverRoomDelay_ns(txParked_.bytes);
+        if (wait_ns > 0) {
+            tx_timer_.expires_after(std::chrono::nanoseconds(wait_ns));
+            tx_timer_.async_wait([this](const boost::system::error_code&) { writeTx(); });
+            return;
+        }
+    }
+    const size_t bytes = txParked_.bytes;
+    boost::asio::async_write(serial_, boost::asio::buffer(txBatch_, bytes),
+        boost::asio::bind_executor(tx_timer_.get_executor(),
+            [this, bytes](const boost::system::error_code& ec, std::size_t) {
+                finishTxWrite(bytes, ec);
+                pumpTx();
+            }));
+}
+
+long UART_Serial::driverRoomDelay_ns(size_t bytes) {
+#if defined(__linux__)
+    // TIOCOUTQ: bytes written but not yet on the wire. About as long as the excess
+    // takes to drain, so a peer holding CTS costs a few wakeups, not a spin.
+    const int fd = serial_.native_handle();
+    int queued = 0;
+    if (ioctl(fd, TIOCOUTQ, &queued) == 0 && queued > 0 && (size_t)queued + bytes > driverTxBytes_) {
+        const size_t excess = std::min((size_t)queued + bytes - driverTxBytes_, (size_t)queued);
+        return std::max<long>((long)excess * byteSpacingTime_ns, 50000);
+    }
+#else
+    (void)bytes;
+#endif
+    return 0;
+}
+
+void UART_Serial::waitDriverRoom(size_t bytes) {
+    long wait_ns;
+    while (txRunning_ && (wait_ns = driverRoomDelay_ns(bytes)) > 0) {
+        std::this_thread::sleep_for(std::chrono::nanoseconds(wait_ns));
+    }
+}
+
+bool UART_Serial::bundleable(const TxFrame& frame) const {
+    // A sub-message is the frame minus sync and CRC: [hdr][len][bytes]. Grants
+    // always go out on their own, so the peer finds them without unpacking.
+    return frame.size - SYNC_SIZE - CRC_SIZE <= MAX_PAYLOAD && frame.bytes[SYNC_SIZE] != CREDIT_HEADER;
+}
+
+void UART_Serial::waitBundleWindow() {
+    // Producers notify while txSchedulerWaiting_ is set; only an Urgent frame or a
+    // disconnect cuts the window short.
+    std::unique_lock<std::mutex> lock(tx_mutex_);
+    txSchedulerWaiting_ = true;
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    tx_cv_.wait_for(lock, std::chrono::microseconds(txBundleWindow_us_), [this]() {
+        return !txRunning_ || !txLanes_[(int)TxPriority::Urgent].queue.empty();
+    });
+    txSchedulerWaiting_ = false;
+}
+
+UART_Serial::TxPacker::TxPacker(UART_Serial& owner, size_t budget)
+    : owner_(owner), budget_(budget) {}
+
+size_t UART_Serial::TxPacker::openWire() const {
+    if (openCount_ == 0) {
+        return 0;
+    }
+    return openCount_ == 1 ? open_.size : (size_t)FRAME_OVERHEAD + bundleLen_;
+}
+
+bool UART_Serial::TxPacker::full() const {
+    return used_ + openWire() >= budget_;
+}
+
+bool UART_Serial::TxPacker::add(const TxFrame& frame) {
+    const size_t sub = frame.size - SYNC_SIZE - CRC_SIZE;
+    const size_t pending = used_ + openWire();
+
+    if (owner_.txBundling_ && openCount_ > 0 && bundleLen_ + sub <= MAX_PAYLOAD && owner_.bundleable(frame)) {
+        // Joins the open bundle: costs the sub-message, plus the bundle's own
+        // [hdr][len] when the open frame turns into a bundle.
+        const size_t extra = openCount_ == 1 ? FRAME_OVERHEAD + bundleLen_ + sub - open_.size : sub;
+        if (pending + extra > budget_) {
+            return false;
+        }
+        std::memcpy(bundle_ + bundleLen_, frame.bytes + SYNC_SIZE, sub);
+        bundleLen_ += sub;
+        openCount_++;
+        return true;
+    }
+
+    if (pending > 0 && pending + frame.size > budget_) {
+        return false;
+    }
+    closeOpen();
+    if (owner_.txBundling_ && owner_.bundleable(frame)) {
+        open_ = frame;
+        openCount_ = 1;
+        std::memcpy(bundle_, frame.bytes + SYNC_SIZE, sub);
+        bundleLen_ = sub;
+    } else {
+        std::memcpy(owner_.txBatch_ + used_, frame.bytes, frame.size);
+        if (frame.bytes[SYNC_SIZE] == CREDIT_HEADER) {
+            owner_.stampCredit(owner_.txBatch_ + used_, owner_.txSentTotal_ + (uint32_t)used_);
+        }
+        used_ += frame.size;
+    }
+    return true;
+}
+
+void UART_Serial::TxPacker::closeOpen() {
+    if (openCount_ == 1) {
+        // Nothing joined it: send the original frame, not a bundle of one.
+        std::memcpy(owner_.txBatch_ + used_, open_.bytes, open_.size);
+        used_ += open_.size;
+    } else if (openCount_ > 1) {
+        uint8_t* out = owner_.txBatch_ + used_;
+        out[0] = SYNC_0;
+        out[1] = SYNC_1;
+        out[SYNC_SIZE] = BUNDLE_HEADER;
+        out[SYNC_SIZE + HEADER_SIZE] = (uint8_t)bundleLen_;
+        std::memcpy(out + PAYLOAD_OFFSET, bundle_, bundleLen_);
+        uint16_t crc = crc16_ccitt(out + SYNC_SIZE, HEADER_SIZE + LEN_SIZE + bundleLen_);
+        out[PAYLOAD_OFFSET + bundleLen_] = (uint8_t)(crc & 0xFF);
+        out[PAYLOAD_OFFSET + bundleLen_ + 1] = (uint8_t)((crc >> 8) & 0xFF);
+        used_ += FRAME_OVERHEAD + bundleLen_;
+        owner_.txBundled_ += openCount_;
+    }
+    openCount_ = 0;
+    bundleLen_ = 0;
+}
+
+size_t UART_Serial::TxPacker::finish() {
+    closeOpen();
+    return used_;
+}
+
+bool UART_Serial::hasPendingTx() const {
+    if (mailboxCount_.load() > 0) {
+        return true;
+    }
+    for (int lane = 0; lane < TX_LANES; ++lane) {
+        if (txCarryFull_[lane] || !txLanes_[lane].queue.empty()) {
+            return true;
+        }
+    }
+    return false;
+}
+
+void UART_Serial::waitForTx() {
+    std::unique_lock<std::mutex> lock(tx_mutex_);
+    txBusy_ = false;
+    txSchedulerWaiting_ = true;
+    // Pairs with the fence in sendMessage().
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    if (txSpaceWaiters_.load() > 0) {
+        tx_space_cv_.notify_all();   // idle: wake flushOutgoing()
+    }
+    auto ready = [this]() { return hasPendingTx() || !txRunning_; };
+    if (creditEnabled_) {
+        // Wake for the periodic grant even with nothing to send.
+        tx_cv_.wait_for(lock, std::chrono::milliseconds((int)CREDIT_REFRESH_MS), ready);
+    } else {
+        tx_cv_.wait(lock, ready);
+    }
+    txSchedulerWaiting_ = false;
+}
+
+void UART_Serial::advertiseCredit() {
+    // Grants what the ring can take now, less what already waits in the frame queue
+    // for receiveMessage() (an undrained queue should slow the peer down rather than
+    // fill up and drop), less slack for grants, which are sent even without credit.
+    // A new grant goes out once the window's edge has moved by a quarter ring, or
+    // at the refresh tick.
+    const ByteRing& ring = *rx_ring_;
+    const size_t used = ring.size() + rxFrames_.size() * MAX_FRAME_SIZE + 2 * (FRAME_OVERHEAD + CREDIT_SIZE);
+    const size_t free = used < ring.capacity() ? std::min(ring.capacity() - used, (size_t)0xFFFF) : 0;
+    const uint32_t received = (uint32_t)(ring.written() + dropped_bytes_.load()) + rxLost_.load();
+    const uint32_t edge = received + (uint32_t)free;
+    const auto now = std::chrono::steady_clock::now();
+
+    std::unique_lock<std::mutex> lock(credit_mutex_);
+    if ((int32_t)(edge - advertisedEdge_) < (int32_t)(ring.capacity() / 4) && now < nextAdvert_) {
+        return;
+    }
+    advertisedEdge_ = edge;
+    nextAdvert_ = now + std::chrono::milliseconds((int)CREDIT_REFRESH_MS);
+    uint8_t grant[CREDIT_SIZE] = {};   // `sent` is stamped as the frame is packed
+    for (int i = 0; i < 4; ++i) {
+        grant[i] = (uint8_t)(received >> (8 * i));
+    }
+    grant[4] = (uint8_t)(free & 0xFF);
+    grant[5] = (uint8_t)(free >> 8);
+    postLatest(CREDIT_HEADER, grant, (uint8_t)CREDIT_SIZE);
+    creditAdverts_++;
+    lock.unlock();
+    wakeTx();
+}
+
+void UART_Serial::takeCredit(const uint8_t* bytes, uint8_t len, size_t at) {
+    // `at` is where the grant frame starts in the receive stream (ring positions;
+    // unknown for a bundled grant). A grant from a peer without credit flow control
+    // enabled here is dropped like any other reserved frame.
+    if (!creditEnabled_ || len < CREDIT_SIZE) {
+        return;
+    }
+    uint32_t received = 0;
+    uint32_t sent = 0;
+    for (int i = 0; i < 4; ++i) {
+        received |= (uint32_t)bytes[i] << (8 * i);
+        sent |= (uint32_t)bytes[6 + i] << (8 * i);
+    }
+    const uint32_t free = (uint32_t)bytes[4] | ((uint32_t)bytes[5] << 8);
+    if (at != SIZE_MAX) {
+        // The line keeps order, so whatever the peer wrote before this frame has
+        // arrived by now or never will. Lost bytes count as received, or the
+        // peer's window would shrink by them for good.
+        const uint32_t arrived = (uint32_t)(at + dropped_bytes_.load()) + rxLost_.load();
+        if ((int32_t)(sent - arrived) > 0) {
+            rxLost_ += sent - arrived;
+        }
+    }
+    peerCreditTime_ns_ = std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count();
+    peerCredit_ = ((uint64_t)received << 32) | (uint32_t)(received + free);
+    creditActive_ = true;
+    creditGrants_++;
+    wakeTx();
+}
+
+long UART_Serial::creditAllowance() {
+    const uint64_t grant = peerCredit_.load();
+    const uint32_t received = (uint32_t)(grant >> 32);
+    const uint32_t edge = (uint32_t)grant;
+    if ((int32_t)(received - txSentTotal_) > 0) {
+        // The peer has counted more than we wrote: we reconnected and started over.
+        // Pick up its count.
+        txSentTotal_ = received;
+    }
+    return (long)(int32_t)(edge - txSentTotal_);
+}
+
+void UART_Serial::stampCredit(uint8_t* frame, uint32_t sent) {
+    uint8_t* payload = frame + PAYLOAD_OFFSET;
+    for (int i = 0; i < 4; ++i) {
+        payload[6 + i] = (uint8_t)(sent >> (8 * i));
+    }
+    uint16_t crc = crc16_ccitt(frame + SYNC_SIZE, HEADER_SIZE + LEN_SIZE + CREDIT_SIZE);
+    payload[CREDIT_SIZE] = (uint8_t)(crc & 0xFF);
+    payload[CREDIT_SIZE + 1] = (uint8_t)((crc >> 8) & 0xFF);
+}
+
+bool UART_Serial::takeCreditFrame(TxFrame& out) {
+    std::lock_guard<std::mutex> lock(mailbox_mutex_);
+    if (!mailboxFull_[CREDIT_HEADER]) {
+        return false;
+    }
+    out = mailbox_[CREDIT_HEADER];
+    mailboxFull_[CREDIT_HEADER] = false;
+    mailboxPerLane_[mailboxLane_[CREDIT_HEADER]]--;
+    mailboxCount_--;
+    return true;
+}
+
+void UART_Serial::waitForCredit(uint32_t grants, uint32_t adverts) {
+    // Until a new grant arrives, we have one of our own to send, or the refresh tick.
+    std::unique_lock<std::mutex> lock(tx_mutex_);
+    txSchedulerWaiting_ = true;
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    tx_cv_.wait_for(lock, std::chrono::milliseconds((int)CREDIT_REFRESH_MS), [&]() {
+        return !txRunning_ || creditGrants_.load() != grants || creditAdverts_.load() != adverts;
+    });
+    txSchedulerWaiting_ = false;
+}
+
+void UART_Serial::notifyTxSpace() {
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    if (txSpaceWaiters_.load() > 0) {
+        std::lock_guard<std::mutex> lock(tx_mutex_);
+        tx_space_cv_.notify_all();
+    }
 }
 
 int UART_Serial::sendMessage(uint8_t header, const float* data, uint8_t numFloats) {
@@ -166,93 +1060,437 @@ int UART_Serial::sendMessage(uint8_t header, const float* data, uint8_t numFloat
 }
 
 int UART_Serial::receiveMessage(uint8_t& header, uint8_t* bytes, uint8_t& len) {
+    if (dispatching_) {
+        Frame frame;
+        if (popQueuedFrames(&frame, 1) == 0) {
+            return -1;
+        }
+        header = frame.header;
+        len = frame.len;
+        std::memcpy(bytes, frame.bytes, frame.len);
+        return 1;
+    }
+
     std::lock_guard<std::mutex> lock(buffer_mutex_);
-    if (!timeoutFlag &&
-        std::chrono::steady_clock::now() - lastTimeoutClock > std::chrono::milliseconds(timeoutPeriod_ms_)) {
-        timeoutFlag = true;
+    checkTimeout();
+
+    size_t seen = rx_ring_->written();
+    int rc = parseFrame(header, bytes, len);
+    releaseRx();
+    if (rc != 1) {
+        // Everything buffered has been looked at; waitForMessages() blocks until more arrives.
+        rxSeen_ = seen;
     }
+    return rc;
+}
 
-    int lastStatus = -1;
+int UART_Serial::receiveMessage(Frame& frame) {
+    if (dispatching_) {
+        return popQueuedFrames(&frame, 1) == 0 ? -1 : 1;
+    }
 
-    // Sync-scan loop with scan_pos_ offset — advance past false syncs without
-    // memmoving the buffer. Compact only on valid frame extraction or when
-    // scan_pos_ exceeds half the buffer size.
-    while (true) {
-        // Compact the leading garbage if scan_pos_ has crept too far forward.
-        if (scan_pos_ > 0 && scan_pos_ > buffer_.size() / 2) {
-            buffer_.erase(buffer_.begin(), buffer_.begin() + scan_pos_);
-            scan_pos_ = 0;
-        }
+    std::lock_guard<std::mutex> lock(buffer_mutex_);
+    checkTimeout();
 
-        if (buffer_.size() < scan_pos_ + SYNC_SIZE) {
-            return lastStatus;
+    size_t seen = rx_ring_->written();
+    int rc = parseFrame(frame.header, frame.bytes, frame.len);
+    releaseRx();
+    if (rc != 1) {
+        rxSeen_ = seen;
+        return rc;
+    }
+    frame.timing = rxTiming_;
+    frame.timing.dispatched = std::chrono::steady_clock::now();
+    frame.rxTime = frame.timing.parsed;
+    return 1;
+}
+
+int UART_Serial::receiveMessages(FrameBatch& batch, size_t maxFrames) {
+    if (maxFrames > batch.capacity()) {
+        maxFrames = batch.capacity();
+    }
+    if (dispatching_) {
+        batch.count = popQueuedFrames(batch.frames.data(), maxFrames);
+        return (int)batch.count;
+    }
+    std::lock_guard<std::mutex> lock(buffer_mutex_);
+    checkTimeout();
+
+    size_t seen = rx_ring_->written();
+    batch.count = drainFrames(batch.frames.data(), maxFrames);
+    if (batch.count < maxFrames) {
+        rxSeen_ = seen;
+    }
+    return (int)batch.count;
+}
+
+size_t UART_Serial::popQueuedFrames(Frame* frames, size_t maxFrames) {
+    {
+        // The read thread holds buffer_mutex_ while it parses and dispatches, which
+        // already proves the link is alive; only check the timeout when it's idle.
+        std::unique_lock<std::mutex> lock(buffer_mutex_, std::try_to_lock);
+        if (lock) {
+            checkTimeout();
+        }
+    }
+    size_t count = 0;
+    {
+        std::lock_guard<std::mutex> lock(rx_frames_mutex_);
+        while (count < maxFrames && rxFrames_.pop(frames[count])) {
+            ++count;
         }
+    }
+    if (count > 0) {
+        const auto now = std::chrono::steady_clock::now();
+        for (size_t i = 0; i < count; ++i) {
+            frames[i].timing.dispatched = now;
+        }
+    }
+    if (creditEnabled_ && count > 0) {
+        advertiseCredit();   // queue space is receive space too
+    }
+    return count;
+}
 
-        // Find next 0xA5 0x5A starting at scan_pos_.
-        size_t syncIdx = 0;
-        bool found = false;
-        for (size_t i = scan_pos_; i + 1 < buffer_.size(); ++i) {
-            if (buffer_[i] == SYNC_0 && buffer_[i + 1] == SYNC_1) {
-                syncIdx = i;
-                found = true;
-                break;
+void UART_Serial::dispatchFrames() {
+    // Handlers get a view straight into the ring; only a payload split by the
+    // wrap point is copied, into `scratch`. The frame is consumed after the call.
+    // Bundles are unpacked in place: each sub-message is routed with a view
+    // into the bundle payload.
+    ByteRing& ring = *rx_ring_;
+    uint8_t scratch[MAX_PAYLOAD];
+    bool queued = false;
+    size_t start;
+    uint8_t header, len;
+    while (findFrame(start, header, len) == 1) {
+        stampFrame(start);
+        const uint8_t* p1;
+        const uint8_t* p2;
+        size_t n1, n2;
+        ring.segments(start + PAYLOAD_OFFSET, len, p1, n1, p2, n2);
+        const uint8_t* view = p1;
+        if (n2 > 0) {
+            ring.copyOut(start + PAYLOAD_OFFSET, scratch, len);
+            view = scratch;
+        }
+        if (header == BUNDLE_HEADER) {
+            size_t pos = 0;
+            uint8_t subHeader, subLen;
+            const uint8_t* sub;
+            while (nextBundled(view, len, pos, subHeader, sub, subLen)) {
+                queued |= routeFrame(subHeader, sub, subLen);
             }
+        } else if (header == CREDIT_HEADER) {
+            takeCredit(view, len, ring.consumed() + start);
+        } else {
+            queued |= routeFrame(header, view, len);
         }
+        consumeRx(FRAME_OVERHEAD + len);
+    }
+    releaseRx();
+    if (queued) {
+        notifyReceived();
+    }
+}
 
-        if (!found) {
-            // No sync. Preserve trailing byte in case it's a 0xA5 starting an
-            // incomplete sync; everything before it is junk.
-            if (buffer_.size() > 1) {
-                scan_pos_ = buffer_.size() - 1;
-            } else {
-                scan_pos_ = 0;
+bool UART_Serial::routeFrame(uint8_t header, const uint8_t* bytes, uint8_t len) {
+    if (header == FRAGMENT_HEADER) {
+        return absorbFragment(bytes, len);
+    }
+    if (header == CREDIT_HEADER) {
+        takeCredit(bytes, len);
+        return false;
+    }
+    const MessageCallback* handler = handlerFor(header);
+    if (handler != nullptr) {
+        rxTiming_.dispatched = std::chrono::steady_clock::now();
+        (*handler)(header, bytes, len);
+        return false;
+    }
+    bool ok = rxFrames_.emplace([&](Frame& frame) {
+        frame.header = header;
+        frame.len = len;
+        std::memcpy(frame.bytes, bytes, len);
+        frame.rxTime = rxTiming_.parsed;
+        frame.timing = rxTiming_;
+    });
+    if (!ok) {
+        dropped_frames_.fetch_add(1);
+    }
+    return true;
+}
+
+bool UART_Serial::absorbFragment(const uint8_t* bytes, uint8_t len) {
+    // Returns true if a finished message was queued for receiveLargeMessage().
+    largeCompleted_ = false;
+    rxFragments_.add(bytes, len, std::chrono::steady_clock::now());
+    return largeCompleted_;
+}
+
+void UART_Serial::completeLarge(uint8_t header, std::vector<uint8_t>& message) {
+    if (largeCallback_) {
+        largeCallback_(header, message.data(), message.size());
+        return;
+    }
+    std::lock_guard<std::mutex> lock(large_mutex_);
+    if (largeQueue_.size() >= LARGE_QUEUE_DEPTH) {
+        largeDropped_++;
+        return;
+    }
+    // The message's buffer moves to the queue; the slot gets a spare one back.
+    largeQueue_.emplace_back();
+    largeQueue_.back().header = header;
+    largeQueue_.back().bytes.swap(message);
+    if (!largeSpare_.empty()) {
+        message.swap(largeSpare_.back());
+        largeSpare_.pop_back();
+    }
+    largeQueued_++;
+    largeCompleted_ = true;
+}
+
+void UART_Serial::pumpFragments() {
+    // Polling mode: take fragment frames off the front of the ring, stopping at the
+    // first ordinary frame (or bundle leftovers) so those stay in wire order for
+    // receiveMessage().
+    if (rxBundlePos_ < rxBundleLen_) {
+        return;
+    }
+    size_t start;
+    uint8_t header, len;
+    uint8_t fragment[MAX_PAYLOAD];
+    while (findFrame(start, header, len) == 1 && header == FRAGMENT_HEADER) {
+        rx_ring_->copyOut(start + PAYLOAD_OFFSET, fragment, len);
+        consumeRx(FRAME_OVERHEAD + len);
+        absorbFragment(fragment, len);
+    }
+    releaseRx();
+}
+
+int UART_Serial::receiveLargeMessage(uint8_t& header, std::vector<uint8_t>& bytes) {
+    if (!dispatching_) {
+        std::lock_guard<std::mutex> lock(buffer_mutex_);
+        checkTimeout();
+        pumpFragments();
+    } else {
+        std::unique_lock<std::mutex> lock(buffer_mutex_, std::try_to_lock);
+        if (lock) {
+            checkTimeout();
+        }
+    }
+
+    std::lock_guard<std::mutex> lock(large_mutex_);
+    if (largeQueue_.empty()) {
+        return -1;
+    }
+    LargeMessage& message = largeQueue_.front();
+    header = message.header;
+    bytes.swap(message.bytes);
+    if (largeSpare_.size() < LARGE_QUEUE_DEPTH) {
+        message.bytes.clear();
+        largeSpare_.push_back(std::move(message.bytes));
+    }
+    largeQueue_.pop_front();
+    largeQueued_--;
+    return 1;
+}
+
+void UART_Serial::onLargeStream(uint8_t header, LargeStreamCallback callback) {
+    rxFragments_.onStream(header, std::move(callback));
+}
+
+bool UART_Serial::setLargeMessageLimits(size_t maxBytes, size_t slots, int timeout_ms) {
+    if (running_) {
+        return false;
+    }
+    std::lock_guard<std::mutex> lock(buffer_mutex_);
+    rxFragments_.setLimits(slots, maxBytes, timeout_ms);
+    return true;
+}
+
+size_t UART_Serial::getDroppedLargeMessageCount() {
+    std::lock_guard<std::mutex> lock(buffer_mutex_);
+    return rxFragments_.dropped() + largeDropped_.load();
+}
+
+const UART_Serial::MessageCallback* UART_Serial::handlerFor(uint8_t header) const {
+    if (headerHandlers_[header]) {
+        return &headerHandlers_[header];
+    }
+    if (queuedHeaders_[header] || !messageCallback_) {
+        return nullptr;
+    }
+    return &messageCallback_;
+}
+
+void UART_Serial::onHeader(uint8_t header, MessageCallback handler) {
+    headerHandlers_[header] = std::move(handler);
+    if (headerHandlers_[header]) {
+        queuedHeaders_[header] = false;
+    }
+}
+
+void UART_Serial::routeToQueue(uint8_t header) {
+    headerHandlers_[header] = nullptr;
+    queuedHeaders_[header] = true;
+}
+
+size_t UART_Serial::drainFrames(Frame* frames, size_t maxFrames) {
+    // Every frame parsed under the caller's single lock; the ring head moves once.
+    size_t count = 0;
+    while (count < maxFrames) {
+        Frame& frame = frames[count];
+        if (parseFrame(frame.header, frame.bytes, frame.len) != 1) {
+            break;
+        }
+        frame.timing = rxTiming_;
+        frame.rxTime = rxTiming_.parsed;
+        ++count;
+    }
+    releaseRx();
+    if (count > 0) {
+        const auto now = std::chrono::steady_clock::now();
+        for (size_t i = 0; i < count; ++i) {
+            frames[i].timing.dispatched = now;
+        }
+    }
+    return count;
+}
+
+void UART_Serial::checkTimeout() {
+    const auto now = std::chrono::steady_clock::now();
+    if (!timeoutFlag && now - lastTimeoutClock > std::chrono::milliseconds(timeoutPeriod_ms_)) {
+        timeoutFlag = true;
+    }
+    rxFragments_.expire(now);
+}
+
+int UART_Serial::parseFrame(uint8_t& header, uint8_t* bytes, uint8_t& len) {
+    while (true) {
+        // Sub-messages left over from a bundle come out first, one per call.
+        const uint8_t* sub;
+        if (nextBundled(rxBundle_, rxBundleLen_, rxBundlePos_, header, sub, len)) {
+            if (header == FRAGMENT_HEADER) {
+                absorbFragment(sub, len);
+                continue;
+            }
+            if (header == CREDIT_HEADER) {
+                takeCredit(sub, len);
+                continue;
             }
+            std::memcpy(bytes, sub, len);
+            rxTiming_ = rxBundleTiming_;
+            return 1;
+        }
+        rxBundleLen_ = 0;
+        rxBundlePos_ = 0;
+
+        size_t start;
+        int rc = findFrame(start, header, len);
+        if (rc != 1) {
+            return rc;
+        }
+        if (header == BUNDLE_HEADER) {
+            rx_ring_->copyOut(start + PAYLOAD_OFFSET, rxBundle_, len);
+            rxBundleLen_ = len;
+            stampFrame(start);
+            rxBundleTiming_ = rxTiming_;
+            consumeRx(FRAME_OVERHEAD + len);
+            continue;
+        }
+        if (header == FRAGMENT_HEADER) {
+            uint8_t fragment[MAX_PAYLOAD];
+            rx_ring_->copyOut(start + PAYLOAD_OFFSET, fragment, len);
+            consumeRx(FRAME_OVERHEAD + len);
+            absorbFragment(fragment, len);
+            continue;
+        }
+        if (header == CREDIT_HEADER) {
+            uint8_t grant[MAX_PAYLOAD];
+            rx_ring_->copyOut(start + PAYLOAD_OFFSET, grant, len);
+            takeCredit(grant, len, rx_ring_->consumed() + start);
+            consumeRx(FRAME_OVERHEAD + len);
+            continue;
+        }
+        if (len > 0) {
+            rx_ring_->copyOut(start + PAYLOAD_OFFSET, bytes, len);
+        }
+        stampFrame(start);
+        consumeRx(FRAME_OVERHEAD + len);
+        return 1;
+    }
+}
+
+int UART_Serial::findFrame(size_t& start, uint8_t& header, uint8_t& len) {
+    ByteRing& ring = *rx_ring_;
+    int lastStatus = -1;
+
+    // Bytes before a sync candidate are junk and are skipped right away, so the
+    // candidate always sits at offset `start`. Skipped bytes are held (rxHeld_)
+    // and handed back to the read thread in one go by releaseRx(): no erase or
+    // memmove on false syncs or on frame extraction. Candidates come from a
+    // batched SIMD scan, so a false sync jumps straight to the next one.
+    while (true) {
+        const size_t avail = ring.size() - rxHeld_;
+        if (avail < SYNC_SIZE) {
             return lastStatus;
         }
 
+        size_t syncIdx = nextSync(avail);
+        if (syncIdx == SIZE_MAX) {
+            // No sync. Keep a trailing 0xA5 in case it starts an incomplete sync;
+            // everything else is junk.
+            consumeRx(ring.at(rxHeld_ + avail - 1) == SYNC_0 ? avail - 1 : avail);
+            return lastStatus;
+        }
+        consumeRx(syncIdx);
+        start = rxHeld_;
+        const size_t have = avail - syncIdx;
+
         // Need sync + header + len = 4 bytes minimum to inspect len.
-        if (buffer_.size() < syncIdx + SYNC_SIZE + HEADER_SIZE + LEN_SIZE) {
-            scan_pos_ = syncIdx;
+        if (have < SYNC_SIZE + HEADER_SIZE + LEN_SIZE) {
             return -1;
         }
 
-        uint8_t hdr = buffer_[syncIdx + SYNC_SIZE];
-        uint8_t plen = buffer_[syncIdx + SYNC_SIZE + HEADER_SIZE];
+        uint8_t hdr = ring.at(start + SYNC_SIZE);
+        uint8_t plen = ring.at(start + SYNC_SIZE + HEADER_SIZE);
 
         if (plen > MAX_PAYLOAD) {
-            // Implausible len — false sync. Advance one byte.
-            scan_pos_ = syncIdx + 1;
+            // Implausible len — false sync. Move on to the next candidate.
+            consumeRx(1);
             lastStatus = -4;
             continue;
         }
 
-        size_t total = syncIdx + FRAME_OVERHEAD + plen;
-        if (buffer_.size() < total) {
+        size_t total = FRAME_OVERHEAD + plen;
+        if (have < total) {
             // Frame not fully arrived yet. Stay parked at this sync.
-            scan_pos_ = syncIdx;
             return -2;
         }
 
-        // CRC over [hdr][len][bytes] — sync excluded.
-        uint16_t computed = crc16_ccitt(&buffer_[syncIdx + SYNC_SIZE], HEADER_SIZE + LEN_SIZE + plen);
-        uint16_t received = (uint16_t)buffer_[total - 2]
-                          | ((uint16_t)buffer_[total - 1] << 8);
+        // CRC over [hdr][len][bytes] — sync excluded. Runs across the wrap point
+        // in two pieces by continuing from the first piece's CRC.
+        const uint8_t* p1;
+        const uint8_t* p2;
+        size_t n1, n2;
+        ring.segments(start + SYNC_SIZE, HEADER_SIZE + LEN_SIZE + plen, p1, n1, p2, n2);
+        uint16_t computed = ::crc16_ccitt(p1, n1);
+        if (n2 > 0) {
+            computed = ::crc16_ccitt(p2, n2, computed);
+        }
+        uint16_t received = (uint16_t)ring.at(start + total - 2)
+                          | ((uint16_t)ring.at(start + total - 1) << 8);
 
         if (computed != received) {
-            // False sync match or corrupted frame. Advance past this sync byte.
-            scan_pos_ = syncIdx + 1;
+            // False sync match or corrupted frame. Move on to the next candidate.
+            consumeRx(1);
             lastStatus = -3;
             continue;
         }
 
-        // Valid frame.
+        // Valid frame, left in place at `start` for the caller to copy or view.
         header = hdr;
         len = plen;
-        if (plen > 0) {
-            std::memcpy(bytes, &buffer_[syncIdx + SYNC_SIZE + HEADER_SIZE + LEN_SIZE], plen);
-        }
-        buffer_.erase(buffer_.begin(), buffer_.begin() + total);
-        scan_pos_ = 0;
 
         timeoutFlag = false;
         lastTimeoutClock = std::chrono::steady_clock::now();
@@ -260,6 +1498,109 @@ int UART_Serial::receiveMessage(uint8_t& header, uint8_t* bytes, uint8_t& len) {
     }
 }
 
+void UART_Serial::consumeRx(size_t n) {
+    rxHeld_ += n;
+    syncShift_ += n;
+}
+
+void UART_Serial::releaseRx() {
+    if (rxHeld_ > 0) {
+        rx_ring_->consume(rxHeld_);
+        rxHeld_ = 0;
+    }
+}
+
+void UART_Serial::stampFrame(size_t start) {
+    // Pass every read that began at or before the frame's first byte; the last
+    // one passed brought that byte in, unless marks were lost after it: then the
+    // read that did is unknown and arrival stays unset.
+    const size_t position = rx_ring_->consumed() + start;
+    while (true) {
+        if (!rxHasNextMark_ && !(rxHasNextMark_ = rxMarks_->pop(rxNextMark_))) {
+            break;
+        }
+        if (rxNextMark_.position > position) {
+            break;
+        }
+        rxMark_ = rxNextMark_;
+        rxHasNextMark_ = false;
+    }
+    const bool lost = rxHasNextMark_ ? rxNextMark_.lostBefore : rxMarksLost_.load();
+    rxTiming_.arrival = lost ? RxTiming::TimePoint() : rxMark_.at;
+    rxTiming_.kernel = RxTiming::TimePoint();
+    rxTiming_.parsed = std::chrono::steady_clock::now();
+    rxTiming_.dispatched = RxTiming::TimePoint();
+}
+
+void UART_Serial::resetArrivalMarks() {
+    ArrivalMark mark;
+    while (rxMarks_->pop(mark)) {
+    }
+    rxMark_ = ArrivalMark();
+    rxHasNextMark_ = false;
+    rxMarksLost_ = false;
+}
+
+void UART_Serial::resetSyncScan() {
+    syncCount_ = 0;
+    syncNext_ = 0;
+    syncScanEnd_ = 0;
+    syncShift_ = 0;
+}
+
+size_t UART_Serial::nextSync(size_t available) {
+    while (true) {
+        // Pending candidates from the last scan; ones already consumed are skipped.
+        while (syncNext_ < syncCount_) {
+            size_t candidate = syncCandidates_[syncNext_];
+            if (candidate >= syncShift_) {
+                return candidate - syncShift_;
+            }
+            ++syncNext_;
+        }
+
+        // Batch exhausted: scan the bytes not looked at yet. The last byte of the
+        // previous scan is included again since its partner may have arrived since.
+        size_t from = syncScanEnd_ > syncShift_ ? syncScanEnd_ - syncShift_ : 0;
+        if (from + 1 >= available) {
+            return SIZE_MAX;
+        }
+        syncShift_ = 0;
+        syncNext_ = 0;
+        syncCount_ = scanSync(from, available, syncCandidates_, SYNC_BATCH);
+        syncScanEnd_ = syncCount_ == SYNC_BATCH ? syncCandidates_[SYNC_BATCH - 1] + 1 : available - 1;
+        if (syncCount_ == 0) {
+            return SIZE_MAX;
+        }
+    }
+}
+
+size_t UART_Serial::scanSync(size_t from, size_t available, size_t* out, size_t maxOut) const {
+    // Vector scan through each contiguous piece of the ring; a pair split across
+    // the wrap point is checked on its own. Offsets are relative to the first
+    // unparsed byte (ring head + rxHeld_).
+    const uint8_t* p1;
+    const uint8_t* p2;
+    size_t n1, n2;
+    rx_ring_->segments(rxHeld_ + from, available - from, p1, n1, p2, n2);
+
+    size_t count = sync_scan(p1, n1, SYNC_0, SYNC_1, out, maxOut);
+    for (size_t i = 0; i < count; ++i) {
+        out[i] += from;
+    }
+    if (n2 == 0 || count == maxOut) {
+        return count;
+    }
+    if (p1[n1 - 1] == SYNC_0 && p2[0] == SYNC_1) {
+        out[count++] = from + n1 - 1;
+    }
+    size_t more = sync_scan(p2, n2, SYNC_0, SYNC_1, out + count, maxOut - count);
+    for (size_t i = count; i < count + more; ++i) {
+        out[i] += from + n1;
+    }
+    return count + more;
+}
+
 int UART_Serial::receiveMessage(uint8_t& header, float* data, uint8_t& numFloats) {
     uint8_t buf[MAX_PAYLOAD];
     uint8_t len = 0;
@@ -279,81 +1620,266 @@ int UART_Serial::receiveMessage(uint8_t& header, float* data, uint8_t& numFloats
     return 1;
 }
 
-uint16_t UART_Serial::crc16_ccitt(const uint8_t* data, int len) {
-    uint16_t crc = 0xFFFF;
-    for (int i = 0; i < len; ++i) {
-        crc ^= ((uint16_t)data[i]) << 8;
-        for (int j = 0; j < 8; ++j) {
-            if (crc & 0x8000) crc = (uint16_t)((crc << 1) ^ 0x1021);
-            else              crc = (uint16_t)(crc << 1);
+bool UART_Serial::hasReceived() const {
+    if (largeQueued_.load() > 0) {
+        return true;
+    }
+    return dispatching_ ? !rxFrames_.empty() : rx_ring_->written() != rxSeen_;
+}
+
+bool UART_Serial::waitForMessages(int timeout_ms) {
+    if (!hasReceived() && running_) {
+        std::unique_lock<std::mutex> lock(rx_wait_mutex_);
+        rxWaiters_++;
+        // Pairs with the fence in notifyReceived(): either we see the new bytes or it sees us.
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+
+        auto ready = [this]() { return hasReceived() || !running_; };
+        if (timeout_ms < 0) {
+            rx_wait_cv_.wait(lock, ready);
+        } else {
+            rx_wait_cv_.wait_for(lock, std::chrono::milliseconds(timeout_ms), ready);
         }
+        rxWaiters_--;
+    }
+
+    if (hasReceived()) {
+        return true;
+    }
+    if (dispatching_) {
+        return false;
     }
-    return crc;
+    // Nothing arrived: keep isConnected() current for callers that only wait.
+    std::lock_guard<std::mutex> lock(buffer_mutex_);
+    checkTimeout();
+    return false;
+}
+
+void UART_Serial::notifyReceived() {
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    if (rxWaiters_.load() > 0) {
+        std::lock_guard<std::mutex> lock(rx_wait_mutex_);
+        rx_wait_cv_.notify_all();
+    }
+}
+
+uint16_t UART_Serial::crc16_ccitt(const uint8_t* data, int len) {
+    return ::crc16_ccitt(data, static_cast<size_t>(len));
 }
 
 void UART_Serial::readFromSerial() {
-    while (running_) {
-        uint8_t temp[1024];
-        boost::system::error_code ec;
-        std::size_t bytes_read = serial_.read_some(boost::asio::buffer(temp), ec);
-
-        if (ec) {
-            if (ec == boost::asio::error::would_block) {
-                // Normal idle on non-blocking platforms — no data right now.
-            } else if (ec == boost::asio::error::eof ||
-                       ec == boost::asio::error::operation_aborted ||
-                       ec == boost::asio::error::bad_descriptor) {
-                // Device gone (cable unplugged, peer closed, fd closed by
-                // disconnect()). Retrying just busy-loops with sleeps and
-                // makes shutdown drag (50 ms × N iterations). Exit the read
-                // loop so disconnect()/join completes promptly. timeoutFlag
-                // = true marks the link as down for any caller polling
-                // isConnected().
-                std::cerr << "Serial port " << ec.message()
-                          << " — exiting read loop." << std::endl;
-                timeoutFlag = true;
-                break;
+    // Runs until disconnect() stops io_context_ or the device goes away (the
+    // read chain ends and run() returns).
+    startRead();
+    io_context_.run();
+}
+
+void UART_Serial::readDone() {
+    std::lock_guard<std::mutex> lock(read_mutex_);
+    readActive_ = false;
+    read_cv_.notify_all();
+}
+
+void UART_Serial::startRead() {
+    // Read straight into the ring's free span. If the consumer has fallen
+    // so far behind that the ring is full, the bytes still have to be read
+    // (or the kernel buffer fills instead) but are dropped and counted.
+    size_t span = 0;
+    uint8_t* dst = rx_ring_->writePtr(span);
+    const bool ringFull = span == 0;
+    boost::asio::mutable_buffer buffer = ringFull
+        ? boost::asio::buffer(rx_overflow_)
+        : boost::asio::buffer(dst, span);
+    serial_.async_read_some(buffer,
+        [this, ringFull](const boost::system::error_code& ec, std::size_t bytes_read) {
+            handleRead(ec, bytes_read, ringFull);
+        });
+}
+
+void UART_Serial::handleRead(const boost::system::error_code& ec, std::size_t bytes_read, bool ringFull) {
+    const auto arrived = std::chrono::steady_clock::now();
+    if (!running_) {
+        readDone();
+        return;
+    }
+
+    if (ec) {
+        if (ec == boost::asio::error::eof ||
+            ec == boost::asio::error::operation_aborted ||
+            ec == boost::asio::error::bad_descriptor) {
+            // Device gone (cable unplugged, peer closed, fd closed). Retrying
+            // just busy-loops, so end the read chain; run() returns and the
+            // read thread exits. timeoutFlag = true marks the link as down for
+            // any caller polling isConnected().
+            std::cerr << "Serial port " << ec.message()
+                      << " — exiting read loop." << std::endl;
+            timeoutFlag = true;
+            readDone();
+            return;
+        }
+        // Transient error: back off briefly.
+        std::cerr << "Error reading from serial port: " << ec.message() << std::endl;
+        read_timer_.expires_after(std::chrono::milliseconds(50));
+        read_timer_.async_wait([this](const boost::system::error_code& timerEc) {
+            if (timerEc || !running_) {
+                readDone();
             } else {
-                // Transient error: back off briefly.
-                std::cerr << "Error reading from serial port: " << ec.message() << std::endl;
-                std::this_thread::sleep_for(std::chrono::milliseconds(50));
-                continue;
+                startRead();
             }
+        });
+        return;
+    }
+
+    if (bytes_read > 0) {
+        if (ringFull) {
+            dropped_bytes_.fetch_add(bytes_read);
+        } else {
+            // The mark goes in before the bytes are published, so a parser that
+            // sees them also sees when they arrived.
+            ArrivalMark mark;
+            mark.position = rx_ring_->written();
+            mark.at = arrived;
+            mark.lostBefore = rxMarksLost_.load();
+            if (rxMarks_->push(mark)) {
+                rxMarksLost_ = false;
+            } else {
+                rxMarksLost_ = true;
+            }
+            rx_ring_->commit(bytes_read);
         }
 
-        if (bytes_read > 0) {
+        if (dispatching_) {
+            // Parse right away and hand each frame to its handler or the queue.
             std::lock_guard<std::mutex> lock(buffer_mutex_);
-            buffer_.insert(buffer_.end(), temp, temp + bytes_read);
-
-            // Cap buffer at BUFFER_CAP — drop oldest half on overflow so the
-            // consumer can recover via CRC instead of seeing unbounded growth.
-            if (buffer_.size() > BUFFER_CAP) {
-                size_t drop = buffer_.size() - BUFFER_CAP / 2;
-                buffer_.erase(buffer_.begin(), buffer_.begin() + drop);
-                scan_pos_ = 0;
-                dropped_bytes_.fetch_add(drop);
+            dispatchFrames();
+        } else {
+            notifyReceived();
+        }
+    }
+    if (creditEnabled_) {
+        advertiseCredit();
+    }
+
+    // Batched: let a few more bytes accumulate before the next read so it
+    // returns a batch instead of single bytes. What was just read is already
+    // published and no lock is held while waiting. Skipped for LowLatency and
+    // when per-header handlers are registered.
+    if (readProfile_ == ReadProfile::Batched && !headerDispatch_ && bytes_read > 0) {
+        read_timer_.expires_after(std::chrono::nanoseconds(5 * byteSpacingTime_ns));
+        read_timer_.async_wait([this](const boost::system::error_code& timerEc) {
+            if (timerEc || !running_) {
+                readDone();
+            } else {
+                startRead();
             }
+        });
+    } else {
+        startRead();
+    }
+}
 
-            // Hold the lock across the inter-iteration sleep. This is
-            // load-bearing: releasing the lock per-iteration was tried in
-            // commit dddd198 and tanked rx throughput from ~50 Hz to ~0.6 Hz
-            // because there was no other consumer to grab it (the old sync
-            // thread cleared the buffer mid-frame). Even with the sync thread
-            // gone, a tight per-iteration lock-acquire pattern is wasteful;
-            // batch under one lock.
-            std::this_thread::sleep_for(std::chrono::microseconds(5 * byteSpacingTime_us));
-        }
+void UART_Serial::configureLowLatency(int fd) {
+#if defined(__linux__)
+    // Asks the driver to push received bytes to the line discipline at once
+    // instead of on its flip-buffer timer. Not all drivers support it (ptys,
+    // some USB adapters); the profile still works without it.
+    serial_struct info{};
+    if (ioctl(fd, TIOCGSERIAL, &info) == 0) {
+        info.flags |= ASYNC_LOW_LATENCY;
+        ioctl(fd, TIOCSSERIAL, &info);
     }
+#else
+    (void)fd;
+#endif
 }
 
 void UART_Serial::startWorkThreads() {
+    bool anyHandler = false;
+    for (const MessageCallback& handler : headerHandlers_) {
+        if (handler) {
+            anyHandler = true;
+            break;
+        }
+    }
+    headerDispatch_ = anyHandler;
+    dispatching_ = anyHandler || messageCallback_ || largeCallback_ || rxFragments_.streaming() || creditEnabled_;
+    // Our count starts over; creditAllowance() picks up the peer's if it kept it.
+    // Grants are posted from the read chain too, so this is in place before it starts.
+    creditActive_ = false;
+    txSentTotal_ = 0;
+    if (creditEnabled_) {
+        headerPriority_[CREDIT_HEADER] = TxPriority::Urgent;
+        headerLatest_[CREDIT_HEADER] = true;
+        std::lock_guard<std::mutex> lock(credit_mutex_);
+        nextAdvert_ = std::chrono::steady_clock::time_point();
+    }
     running_ = true;
-    read_thread_ = std::thread(&UART_Serial::readFromSerial, this);
+    {
+        std::lock_guard<std::mutex> lock(read_mutex_);
+        readActive_ = true;
+    }
+    if (ownContext_) {
+        io_context_.restart();
+        read_thread_ = std::thread(&UART_Serial::readFromSerial, this);
+    } else {
+        boost::asio::post(serial_.get_executor(), [this]() { startRead(); });
+    }
+    txWireFree_ = std::chrono::steady_clock::now();
+    txWindowWaited_ = false;
+    txRunning_ = true;
+    if (ownContext_) {
+        tx_thread_ = std::thread(&UART_Serial::txScheduler, this);
+    } else {
+        {
+            std::lock_guard<std::mutex> lock(tx_mutex_);
+            txPumpActive_ = true;
+        }
+        boost::asio::post(tx_timer_.get_executor(), [this]() { pumpTx(); });
+    }
 }
 
 void UART_Serial::stopWorkThreads() {
+    {
+        std::lock_guard<std::mutex> lock(tx_mutex_);
+        txRunning_ = false;
+        tx_cv_.notify_all();
+        tx_space_cv_.notify_all();
+    }
+    if (tx_thread_.joinable()) {
+        tx_thread_.join();
+    } else if (!ownContext_) {
+        // Shared context: end the pump's wait on its strand and let it drain, and
+        // let any kick already posted run out.
+        std::unique_lock<std::mutex> lock(tx_mutex_);
+        if (txPumpActive_) {
+            txKicks_++;
+            boost::asio::post(tx_timer_.get_executor(), [this]() {
+                boost::system::error_code ec;
+                tx_timer_.cancel(ec);
+                std::lock_guard<std::mutex> lock(tx_mutex_);
+                txKicks_--;
+                tx_cv_.notify_all();
+            });
+            tx_cv_.wait(lock, [this]() { return !txPumpActive_ && txKicks_.load() == 0; });
+        }
+    }
     running_ = false;
-    if (read_thread_.joinable()) {
-        read_thread_.join();
+    if (ownContext_) {
+        io_context_.stop();
+        if (read_thread_.joinable()) {
+            read_thread_.join();
+        }
+        return;
+    }
+    // Shared context: cancel the pending read or timer on the port's strand (never
+    // concurrently with a handler) and wait for the chain to notice and end.
+    std::unique_lock<std::mutex> lock(read_mutex_);
+    if (readActive_) {
+        boost::asio::post(serial_.get_executor(), [this]() {
+            boost::system::error_code ec;
+            read_timer_.cancel(ec);
+            serial_.cancel(ec);
+        });
+        read_cv_.wait(lock, [this]() { return !readActive_; });
     }
 }
@@ -67,15 +67,18 @@ void receiveThread_doWork(std::shared_ptr<UART_Serial> serial)
 {
     while (!killCommand && !g_stop)
     {
+        // Sleeps until bytes arrive; the timeout only bounds how long a stop takes to notice.
+        if (!serial->waitForMessages(100))
+            continue;
+
         uint8_t header = 0;
         float data[UART_Serial::MAX_FLOATS];
         uint8_t numFloats = 0;
-        if (serial->receiveMessage(header, data, numFloats) == 1)
+        while (serial->receiveMessage(header, data, numFloats) == 1)
         {
             std::lock_guard<std::mutex> lock(recvMutex);
             latestMsg = { header, std::vector<float>(data, data + numFloats), true };
         }
-        std::this_thread::sleep_for(std::chrono::milliseconds(1));
     }
 }
 